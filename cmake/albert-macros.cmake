@@ -30,10 +30,14 @@
 # |  binary_dependencies | string list  | Default: `[]`. Required executables.                                      |
 # |  plugin_dependencies | string list  | Default: `[]`. Required plugins.                                          |
 # |              credits | string list  | Default: `[]`. Attributions, mentions, third party library licenses, …    |
+# |             triggers | string list  | Default: `[]`. Default triggers of the trigger handlers.                  |
+# |             handlers | string list  | Default: `[]`. Handler kinds, `trigger`, `global` or `fallback`.          |
 # |             loadtype |    string    | Default: `user`. `frontend` or `user`.                                    |
 #
 # Note: Local string types can be used to localize the metadata. (e.g. "name[de]": "Anwendungen")
 #
+# Note: Plugins declaring `triggers` and `"handlers": ["trigger"]` are loaded on first use.
+#
 # Translations files in a directory named 'i18n' are added automatically.
 # The filenames must have the pattern <plugin_id>_<language_code>.ts.
 # <plugin_id>.ts is the native plurals file.
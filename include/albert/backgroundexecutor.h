@@ -4,6 +4,7 @@
 #pragma once
 #include <QFutureWatcher>
 #include <QtConcurrentRun>
+#include <albert/threadpool.h>
 #include <atomic>
 #include <functional>
 
@@ -14,6 +15,7 @@ namespace albert
 /// Convenience class for recurring indexing tasks.
 ///
 /// Takes care of the QtConcurrent boilerplate code to start, abort and schedule restarts of threads.
+/// Tasks run in the \ref backgroundThreadPool().
 ///
 /// \ingroup util_query
 ///
@@ -105,7 +107,8 @@ public:
                 }
             });
 
-            future_watcher_->setFuture(QtConcurrent::run([this]{ return parallel(stop_); }));
+            future_watcher_->setFuture(QtConcurrent::run(&backgroundThreadPool(),
+                                                         [this]{ return parallel(stop_); }));
 
         }
     }
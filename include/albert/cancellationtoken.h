@@ -0,0 +1,95 @@
+// SPDX-FileCopyrightText: 2026 Manuel Schneider
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <QtGlobal>
+#include <albert/export.h>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+namespace albert
+{
+
+///
+/// Cooperative cancellation token.
+///
+/// A token is cancelled either explicitly by \ref cancel() or implicitly when its \ref deadline()
+/// passed. Long running operations are expected to poll \ref isCancelled() and return early.
+///
+/// Tokens are cheap to copy. Copies share their state, i.e. cancelling a copy cancels all of them.
+///
+/// This class is thread-safe.
+///
+/// \ingroup core_query
+///
+class ALBERT_EXPORT CancellationToken
+{
+public:
+
+    /// The clock used for deadlines.
+    using Clock = std::chrono::steady_clock;
+
+    /// Constructs a token that is not cancelled and has no deadline.
+    CancellationToken();
+
+    ///
+    /// Returns `true` if the token has been cancelled or its deadline passed; otherwise `false`.
+    ///
+    /// Also returns `true` if any parent token is cancelled. See \ref child().
+    ///
+    bool isCancelled() const;
+
+    ///
+    /// Cancels the token.
+    ///
+    /// Invokes the registered callbacks in the calling thread. Subsequent calls have no effect.
+    ///
+    void cancel();
+
+    ///
+    /// Returns the deadline of this token.
+    ///
+    /// Returns `Clock::time_point::max()` if no deadline is set.
+    ///
+    Clock::time_point deadline() const;
+
+    ///
+    /// Sets the deadline of this token to _deadline_.
+    ///
+    /// Deadlines are checked lazily by \ref isCancelled(). Passing a deadline does _not_ invoke
+    /// the cancellation callbacks.
+    ///
+    void setDeadline(Clock::time_point deadline);
+
+    /// Sets the deadline of this token to _timeout_ from now.
+    void setTimeout(std::chrono::milliseconds timeout);
+
+    ///
+    /// Registers _callback_ to be invoked when the token gets cancelled.
+    ///
+    /// If the token is already cancelled _callback_ is invoked immediately. Returns an identifier
+    /// that can be used to remove the callback.
+    ///
+    /// @note The callback is invoked in the thread calling \ref cancel(). Keep it short.
+    ///
+    uint onCancelled(std::function<void()> callback) const;
+
+    /// Removes the callback with identifier _id_.
+    void removeCallback(uint id) const;
+
+    ///
+    /// Returns a new token that is cancelled when this token is cancelled.
+    ///
+    /// Cancelling the child or setting its deadline does not affect this token.
+    ///
+    CancellationToken child() const;
+
+private:
+
+    class Private;
+    std::shared_ptr<Private> d;
+
+};
+
+}  // namespace albert
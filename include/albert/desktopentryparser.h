@@ -1,16 +1,21 @@
-// Copyright (c) 2024-2024 Manuel Schneider
+// Copyright (c) 2024-2026 Manuel Schneider
 
 #pragma once
+#include <QByteArray>
 #include <QLocale>
 #include <QString>
 #include <albert/export.h>
-#include <map>
 #include <optional>
+#include <string_view>
+#include <vector>
 
 namespace albert::detail {
 
 /// Desktop entry parser
 /// http://standards.freedesktop.org/desktop-entry-spec/latest/
+///
+/// The file is read at once and values are kept as views into the implicitly shared buffer,
+/// i.e. copies are cheap. Localized keys of locales other than the current one are skipped.
 class ALBERT_EXPORT DesktopEntryParser
 {
 public:
@@ -75,8 +80,16 @@ public:
     /// Split an Exec string according to spec
     static std::optional<QStringList> splitExec(const QString &s) noexcept;
 
+    /// Returns the parsed entries in desktop entry format. Skipped localizations are omitted.
+    QByteArray toBytes() const;
+
+    /// Parses a desktop entry from _contents_.
+    static DesktopEntryParser fromBytes(QByteArray contents);
+
 private:
 
+    DesktopEntryParser() = default;
+
     /// Get a raw, unescaped value for a section and key.
     ///
     /// @returns The raw, unescaped string of the key in section
@@ -97,7 +110,28 @@ private:
     /// @throws out_of_range if lookup failed
     QString getEscapedValue(const QString &section, const QString &key) const;
 
-    std::map<QString, std::map<QString,QString>> data;
+    /// Resolves the escape sequences in _raw_.
+    static QString unescape(const QString &raw);
+
+    /// Returns the raw value of key in section or std::nullopt if it does not exist.
+    std::optional<std::string_view> find(const QString &section, const QString &key) const;
+
+    void parse(std::string_view bytes);
+
+    struct Entry
+    {
+        std::string_view key;
+        std::string_view value;
+    };
+
+    struct Section
+    {
+        std::string_view name;
+        std::vector<Entry> entries;
+    };
+
+    QByteArray buffer;  // Never detached, the views stay valid in copies
+    std::vector<Section> sections;
     QLocale locale;
 
 };
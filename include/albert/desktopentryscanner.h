@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: 2026 Manuel Schneider
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <QObject>
+#include <QString>
+#include <albert/desktopentryparser.h>
+#include <albert/export.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace albert::detail {
+
+///
+/// Scans the XDG application directories for desktop entries.
+///
+/// Directories are enumerated and files are parsed in the \ref backgroundThreadPool(). Parsed
+/// entries are cached in the cache location keyed by path, modification time and size, such
+/// that rescans parse changed files only. The directories are watched and changes are
+/// published incrementally.
+///
+/// This class is not thread-safe. Use it in the main thread.
+///
+class ALBERT_EXPORT DesktopEntryScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /// A desktop entry.
+    struct Entry
+    {
+        QString id;  ///< The desktop file id, e.g. `org.kde.konsole.desktop`.
+        QString path;  ///< The path of the desktop file.
+        std::shared_ptr<DesktopEntryParser> parser;  ///< The parsed desktop file.
+    };
+
+    /// The changes found by a scan.
+    struct ChangeSet
+    {
+        std::vector<Entry> added;  ///< New entries.
+        std::vector<Entry> modified;  ///< Changed entries.
+        std::vector<QString> removed;  ///< Desktop file ids of removed entries.
+    };
+
+    /// Returns the scanner. Starts a scan on first use.
+    static DesktopEntryScanner &instance();
+
+    ///
+    /// Destroys the scanner, waiting for a running scan.
+    ///
+    /// Called by the application before it shuts down. A later \ref instance() creates a new one.
+    ///
+    static void shutdown();
+
+    ///
+    /// Returns the desktop entries by desktop file id.
+    ///
+    /// Before the first scan finished these are the entries of the disk cache. Entries shadowed
+    /// by entries with the same id in directories of higher precedence are omitted.
+    ///
+    const std::map<QString, Entry> &entries() const;
+
+    /// Rescans the directories. Called automatically when the directories change.
+    void rescan();
+
+signals:
+
+    /// Emitted when a scan found changes. \ref entries() is up to date already.
+    void changed(const albert::detail::DesktopEntryScanner::ChangeSet &changes);
+
+private:
+
+    DesktopEntryScanner();
+    ~DesktopEntryScanner() override;
+
+    class Private;
+    std::unique_ptr<Private> d;
+
+};
+
+}
@@ -41,10 +41,28 @@ public:
     ///
     virtual ItemGenerator items(QueryContext &context) = 0;
 
+    ///
+    /// Returns the number of batches to compute ahead.
+    ///
+    /// The execution keeps advancing the generator in the background until this number of batches
+    /// is queued, such that fetching more items does not have to wait for the generator. Useful
+    /// for slow, e.g. network backed, generators. The base implementation returns 0, i.e. batches
+    /// are computed on demand only.
+    ///
+    virtual uint readAhead() const;
+
 protected:
     /// Destructs the handler.
     ~GeneratorQueryHandler() override;
 
+    ///
+    /// Returns the recommended size of the batch currently generated.
+    ///
+    /// The size adapts to the viewport and scroll velocity of the frontend. Valid in generator
+    /// steps, i.e. in \ref items() and after resuming from `co_yield`. Returns 10 otherwise.
+    ///
+    static uint batchSize();
+
     /// Returns a threaded synchronous generator query execution for _context_.
     std::unique_ptr<QueryExecution> execution(QueryContext &context) override;
 };
@@ -35,6 +35,17 @@ public:
     ///
     virtual std::vector<std::shared_ptr<Item>> handleEmptyQuery();
 
+    ///
+    /// Returns the generation of the results of this handler.
+    ///
+    /// Results of handlers returning a non-zero generation are cached per normalized query. The
+    /// handler has to change the generation whenever \ref rankItems may return different results
+    /// for the same query. The base implementation returns 0, i.e. results are not cached.
+    ///
+    /// This function is called from several threads.
+    ///
+    virtual uint resultGeneration() const;
+
 protected:
     /// Destructs the handler.
     ~GlobalQueryHandler() override;
@@ -63,6 +63,9 @@ public:
     ///
     /// Returns the cache key of the icon.
     ///
+    /// Rendered pixmaps are cached process-wide using this key. Icons with equal keys must render
+    /// equally. Return an empty string to disable caching.
+    ///
     /// The base implementation calls \ref toUrl. Reimplement to get faster lookups.
     ///
     virtual QString cacheKey();
@@ -79,7 +82,12 @@ public:
     /// @name Image icon
     /// @{
 
+    ///
     /// Returns an icon from an image file at _path_.
+    ///
+    /// When painted, the image is decoded asynchronously. Until then the icon paints nothing.
+    /// Query results are repainted when it is ready. Pixmaps and `QIcon`s decode synchronously.
+    ///
     static std::unique_ptr<Icon> image(const QString &path);
 
     /// @copydoc image(const QString &)
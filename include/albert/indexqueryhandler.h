@@ -51,6 +51,15 @@ protected:
     /// Constructs an index query handler.
     IndexQueryHandler();
 
+    ///
+    /// Returns the generation of the index.
+    ///
+    /// Changes whenever the index changes. Results are not cached by default. Return this from
+    /// \ref resultGeneration to opt in, if \ref rankItems returns results depending on the index
+    /// only.
+    ///
+    uint indexGeneration() const;
+
     /// Destructs the index query handler.
     ~IndexQueryHandler() override;
 
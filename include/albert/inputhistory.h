@@ -4,6 +4,7 @@
 #pragma once
 #include <QObject>
 #include <QString>
+#include <QStringList>
 #include <albert/export.h>
 #include <memory>
 
@@ -24,6 +25,14 @@ public:
     InputHistory(const QString &path = {});
     ~InputHistory() override;
 
+    ///
+    /// Returns the history stored at _path_, most recent entries first.
+    ///
+    /// Does not include entries of instances not destroyed yet. An empty path reads the default
+    /// location.
+    ///
+    static QStringList load(const QString &path = {});
+
     ///
     /// Adds text to history search.
     ///
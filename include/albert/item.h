@@ -114,6 +114,16 @@ public:
     ///
     virtual std::vector<Action> actions() const;
 
+    ///
+    /// Returns the canonical identity of the target of this item.
+    ///
+    /// Items of different global query handlers having the same identity are merged if result
+    /// deduplication is enabled. Use a canonical representation of the target, e.g. a file path,
+    /// URL or desktop entry id. The base implementation returns an empty string, i.e. the item is
+    /// never merged.
+    ///
+    virtual QString identity() const;
+
     /// Interface class for item observers
     class Observer
     {
@@ -135,6 +145,7 @@ public:
 
 namespace detail
 {
+class ItemChangeHub;
 class ALBERT_EXPORT DynamicItem : public Item
 {
 public:
@@ -142,6 +153,12 @@ public:
     DynamicItem();
     ~DynamicItem() override;
 
+    ///
+    /// Notifies the observers that the item changed.
+    ///
+    /// Notifications are coalesced. Observers are notified once per event loop pass in the main
+    /// thread, no matter how often this function has been called in between. Thread-safe.
+    ///
     void dataChanged() const;
 
     void addObserver(Observer *) override;
@@ -151,6 +168,7 @@ private:
 
     class Private;
     std::unique_ptr<Private> d;
+    friend class ItemChangeHub;
 
 };
 }
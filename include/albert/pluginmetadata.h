@@ -104,6 +104,21 @@ public:
     ///
     QStringList platforms;
 
+    ///
+    /// Default triggers of the trigger query handlers of the plugin.
+    ///
+    /// The first trigger is expected to be the one of the handler having the plugin id.
+    ///
+    QStringList triggers;
+
+    ///
+    /// Kinds of the handlers provided by the plugin, i.e. `trigger`, `global` or `fallback`.
+    ///
+    /// Plugins declaring triggers and providing trigger query handlers only are loaded on
+    /// first use of a trigger or after an idle delay.
+    ///
+    QStringList handler_kinds;
+
     ///
     /// The load type of the plugin.
     ///
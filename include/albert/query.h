@@ -34,6 +34,9 @@ public:
     /// \copydoc albert::Query::isValid
     bool isValid() const override;
 
+    /// \copydoc albert::Query::cancellationToken
+    const CancellationToken &cancellationToken() const override;
+
     /// \copydoc albert::Query::handler
     QueryHandler &handler() const override;
 
@@ -49,7 +52,7 @@ public:
     /// Returns the execution of this query if running; else nullptr.
     QueryExecution &execution() const;
 
-    /// Stops the query execution.
+    /// Cancels the query and stops the query execution.
     void cancel();
 
     /// Returns the matches.
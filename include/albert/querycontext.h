@@ -7,6 +7,7 @@
 
 namespace albert
 {
+class CancellationToken;
 class QueryHandler;
 class UsageScoring;
 
@@ -26,6 +27,16 @@ public:
     ///
     virtual bool isValid() const = 0;
 
+    ///
+    /// Returns the cancellation token of the query.
+    ///
+    /// Use it to register cancellation callbacks (e.g. to abort network requests) or to pass it to
+    /// cancellable utility functions. Derive a \ref CancellationToken::child() to set deadlines.
+    ///
+    /// This function is thread-safe.
+    ///
+    virtual const CancellationToken &cancellationToken() const = 0;
+
     /// Returns the handler of this query.
     virtual const QueryHandler &handler() const = 0;
 
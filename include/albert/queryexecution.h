@@ -5,6 +5,7 @@
 #include <QObject>
 #include <albert/export.h>
 #include <albert/queryresults.h>
+#include <atomic>
 
 namespace albert
 {
@@ -46,6 +47,29 @@ public:
     /// Returns `true` if the query is being processed, otherwise returns `false`.
     virtual bool isActive() const = 0;
 
+    ///
+    /// Sets the number of results the frontend displays at once.
+    ///
+    /// Used to adapt the size of result batches. This function is thread-safe.
+    ///
+    void setViewportSize(uint rows);
+
+    ///
+    /// Sets the current scroll velocity of the frontend in rows per second.
+    ///
+    /// Used to adapt the size of result batches. This function is thread-safe.
+    ///
+    void setScrollVelocity(double rows_per_second);
+
+    ///
+    /// Returns the size of the next result batch.
+    ///
+    /// The first batch fills the viewport, subsequent batches grow geometrically and cover the
+    /// rows scrolled in a fraction of a second. Each call advances the growth. This function is
+    /// thread-safe.
+    ///
+    uint nextBatchSize();
+
 signals:
 
     ///
@@ -55,6 +79,12 @@ signals:
     ///
     void activeChanged(bool active);
 
+private:
+
+    std::atomic_uint viewport_size_;
+    std::atomic<double> scroll_velocity_;
+    std::atomic_uint batch_count_;
+
 };
 
 }  // namespace albert
@@ -8,6 +8,8 @@
 #include <albert/querycontext.h>
 #include <memory>
 #include <ranges>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace albert
@@ -57,6 +59,14 @@ public:
     /// Activates the action at _action_index_ of the result item at _item_index_.
     bool activate(uint item_index, uint action_index = 0);
 
+    ///
+    /// Sets the range of results currently visible in the frontend.
+    ///
+    /// Changes of visible results are signaled with priority, changes of other results are
+    /// deferred. Pass an empty range (_last_ < _first_) to signal all changes with priority.
+    ///
+    void setVisibleRange(int first, int last);
+
     ///
     /// Appends a \ref QueryResult constructed from _extension_ and _item_.
     ///
@@ -66,6 +76,7 @@ public:
     {
         emit resultsAboutToBeInserted(results.size(), results.size());
         item->addObserver(this);
+        rows.emplace(item.get(), results.size());
         results.emplace_back(&extension, std::forward<decltype(item)>(item));
         emit resultsInserted();
     }
@@ -89,6 +100,7 @@ public:
             for (auto&& query_result : query_results)
             {
                 query_result.item->addObserver(this);
+                rows.emplace(query_result.item.get(), results.size());
                 // results.emplace_back(std::forward_like<decltype(query_results)>(query_result));
                 // TODO remove if forward_like is available everywhere (26.04)
                 if constexpr (std::is_lvalue_reference_v<decltype(query_results)>)
@@ -111,6 +123,7 @@ public:
             for (auto&& item : items)
             {
                 item->addObserver(this);
+                rows.emplace(item.get(), results.size());
                 // results.emplace_back(std::forward_like<decltype(query_results)>(query_result));
                 // TODO remove if forward_like is available everywhere (26.04)
                 if constexpr (std::is_lvalue_reference_v<decltype(items)>)
@@ -129,10 +142,14 @@ public:
     void remove(uint index, uint count = 1)
     {
         for (auto i = index; i < index + count; ++i)
+        {
             results[i].item->removeObserver(this);
+            icon_urls.erase(results[i].item.get());
+        }
 
         emit resultsAboutToBeRemoved(index, index + count - 1);
         results.erase(results.begin() + index,results.begin() + index + count);
+        updateRows(index);
         emit resultsRemoved();
 
     }
@@ -144,6 +161,10 @@ public:
             result.item->removeObserver(this);
         emit resultsAboutToBeReset();
         results.clear();
+        rows.clear();
+        icon_urls.clear();
+        changed_items.clear();
+        deferred_items.clear();
         emit resultsReset();
     }
 
@@ -173,18 +194,43 @@ signals:
     /// Emitted after all results have been reset.
     void resultsReset();
 
+    ///
     /// Emitted when a result changed.
+    ///
+    /// \deprecated Use \ref resultsChanged. Changes are coalesced, this signal is emitted for
+    /// every changed result along with \ref resultsChanged.
+    ///
     void resultChanged(uint i);
 
+    ///
+    /// Emitted when results in the range from _first_ to _last_ changed.
+    ///
+    /// Item changes are coalesced and emitted once per event loop pass.
+    ///
+    void resultsChanged(int first, int last);
+
     /// Emitted when a result was activated.
     void resultActivated(QString query, QString extension_id, QString item_id, QString action_id);
 
 private:
 
     void onItemChanged(const albert::Item *item) override;
+    void onIconsLoaded(const QStringList &paths);
+    void flushChanges();
+    void flushDeferredChanges();
+    void emitChanges(bool defer_invisible);
+    void updateRows(uint first);
 
     const QueryContext &context;
     std::vector<QueryResult> results;
+    std::unordered_multimap<const Item*, uint> rows;  // Item to row index
+    std::unordered_map<const Item*, QString> icon_urls;  // Decoded, lazily for icon repaints
+    std::unordered_set<const Item*> changed_items;
+    std::unordered_set<const Item*> deferred_items;  // Changed while not visible
+    int visible_first = 0;
+    int visible_last = -1;
+    bool flush_scheduled = false;
+    bool deferred_flush_scheduled = false;
 
 };
 
@@ -40,6 +40,9 @@ public:
     /// Yields result of \ref rankItems for _context_ usage scored and lazily sorted.
     ItemGenerator items(QueryContext &context) override;
 
+    /// Returns 0. Sorting batches is cheap, reading ahead is not worth it.
+    uint readAhead() const override;
+
 protected:
     /// Destructs the handler.
     ~RankedQueryHandler() override;
@@ -115,12 +115,21 @@ public:
     /// Sets the item input action text to _text_.
     void setInputActionText(QString text);
 
+    ///
+    /// Sets the item identity to _identity_.
+    ///
+    /// Items with the same identity are merged if result deduplication is enabled. See \ref
+    /// Item::identity(). Empty by default.
+    ///
+    void setIdentity(QString identity);
+
     QString id() const override;
     QString text() const override;
     QString subtext() const override;
     QString inputActionText() const override;
     std::unique_ptr<Icon> icon() const override;
     std::vector<Action> actions() const override;
+    QString identity() const override;
 
 protected:
     QString id_;
@@ -129,6 +138,7 @@ protected:
     std::function<std::unique_ptr<Icon>()> icon_factory_;
     std::vector<Action> actions_;
     QString input_action_text_;
+    QString identity_;
 };
 
 }
@@ -0,0 +1,73 @@
+// SPDX-FileCopyrightText: 2026 Manuel Schneider
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <QThreadPool>
+#include <QtConcurrentTask>
+#include <albert/export.h>
+#include <utility>
+
+namespace albert
+{
+
+/// \addtogroup util_query
+/// @{
+
+///
+/// Task priorities.
+///
+/// Within a thread pool queued tasks of higher priority are started first.
+///
+enum class TaskPriority : int
+{
+    Low = -1,
+    Normal = 0,
+    High = 1
+};
+
+///
+/// Returns the thread pool for latency sensitive work.
+///
+/// Query handling runs in this pool. Do not block it with long running tasks.
+///
+ALBERT_EXPORT QThreadPool &interactiveThreadPool();
+
+///
+/// Returns the thread pool for throughput oriented work, e.g. indexing.
+///
+/// The threads of this pool run with low priority. Tasks in this pool can not starve the
+/// \ref interactiveThreadPool().
+///
+ALBERT_EXPORT QThreadPool &backgroundThreadPool();
+
+///
+/// Runs _function_ in the \ref interactiveThreadPool() with _priority_.
+///
+/// Returns the future of the task.
+///
+template<typename Function>
+auto runInteractive(Function &&function, TaskPriority priority = TaskPriority::Normal)
+{
+    return QtConcurrent::task(std::forward<Function>(function))
+        .onThreadPool(interactiveThreadPool())
+        .withPriority(static_cast<int>(priority))
+        .spawn();
+}
+
+///
+/// Runs _function_ in the \ref backgroundThreadPool() with _priority_.
+///
+/// Returns the future of the task.
+///
+template<typename Function>
+auto runInBackground(Function &&function, TaskPriority priority = TaskPriority::Normal)
+{
+    return QtConcurrent::task(std::forward<Function>(function))
+        .onThreadPool(backgroundThreadPool())
+        .withPriority(static_cast<int>(priority))
+        .spawn();
+}
+
+/// @}
+
+}
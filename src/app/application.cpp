@@ -24,6 +24,8 @@
 #include "systemtrayicon.h"
 #include "systemutil.h"
 #include "telemetry.h"
+#include "threadpool.h"
+#include "trace.h"
 #include "triggersqueryhandler.h"
 #include "urldispatcher.h"
 #include "urlhandler.h"
@@ -32,6 +34,7 @@
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QPointer>
+#include <QSaveFile>
 #include <QSettings>
 #include <QStandardPaths>
 #include <iostream>
@@ -46,6 +49,8 @@ using namespace std;
 namespace {
 App *app_instance = nullptr;
 static const char *STATE_LAST_USED_VERSION = "last_used_version";
+static const char *CFG_INTERACTIVE_THREADS = "interactiveThreads";
+static const char *CFG_BACKGROUND_THREADS = "backgroundThreads";
 }
 
 App &albert::app() { return *app_instance; }
@@ -138,6 +143,18 @@ public:
     TriggersQueryHandler triggers_query_handler;
 };
 
+static void initThreadPools(QSettings &settings)
+{
+    // Zero or unset keeps the defaults
+    if (auto n = settings.value(CFG_INTERACTIVE_THREADS, 0).toInt(); n > 0)
+        interactiveThreadPool().setMaxThreadCount(n);
+    if (auto n = settings.value(CFG_BACKGROUND_THREADS, 0).toInt(); n > 0)
+        backgroundThreadPool().setMaxThreadCount(n);
+    DEBG << "Thread pools (interactive, background):"
+         << interactiveThreadPool().maxThreadCount()
+         << backgroundThreadPool().maxThreadCount();
+}
+
 static filesystem::path initBaseDirectory(QStandardPaths::StandardLocation location)
 {
     path path = QStandardPaths::writableLocation(location).toStdString();
@@ -167,6 +184,8 @@ Application::Application(const Config &cfg):
     auto settings = this->settings();
     auto state = this->state();
 
+    initThreadPools(*settings);
+
     platform::initPlatform();
     platform::initNativeWindow(frontend.winId());
 
@@ -195,9 +214,29 @@ Application::Application(const Config &cfg):
     connect(&query_engine, &QueryEngine::queryHandlerAdded,
             this, reset_session);
 
+    // Deferred plugins are loaded when their triggers are used
+    connect(&plugin_registry, &PluginRegistry::pluginDeferralChanged,
+            this, [this](const QString &id, bool deferred) {
+                if (deferred)
+                {
+                    const auto &m = plugin_registry.plugins().at(id).metadata;
+                    query_engine.addDeferredTriggers(id, m.name, m.description, m.triggers);
+                }
+                else
+                    query_engine.removeDeferredTriggers(id);
+            });
+
+    // Queued, loading changes the triggers while the query engine builds a query
+    connect(&query_engine, &QueryEngine::activationRequested,
+            &plugin_registry, &PluginRegistry::activate, Qt::QueuedConnection);
+
     connect(&query_engine, &QueryEngine::queryHandlerRemoved,
             this, reset_session, Qt::QueuedConnection);
 
+    // Speculate before the frontend shows up
+    connect(&hotkey_manager, &HotkeyManager::activated,
+            this, [this]{ if (!frontend.isVisible()) query_engine.speculate(frontend.input()); });
+
     connect(&hotkey_manager, &HotkeyManager::activated,
             this, &Application::toggle);
 
@@ -220,6 +259,16 @@ Application::~Application()
     extension_registry.deregisterExtension(&plugin_provider);  // unloads plugins
     extension_registry.deregisterExtension(&triggers_query_handler);
     extension_registry.deregisterExtension(&plugin_query_handler);
+
+    platform::deinitPlatform();
+
+    // The pools are function local statics, destroyed after the application. Join the threads
+    // while the application and its objects still exist.
+    for (auto *pool : {&interactiveThreadPool(), &backgroundThreadPool()})
+    {
+        pool->clear();
+        pool->waitForDone();
+    }
 }
 
 const filesystem::path &Application::cacheLocation() { return cache_location; }
@@ -342,6 +391,27 @@ void Application::initRPC()
             else
                 return "'report' expects no arguments.";
 
+        else if (args[0] == "stats")
+
+            if (args.size() == 1)
+                return query_engine.queryMetrics().report().join('\n').toUtf8();
+            else
+                return "'stats' expects no arguments.";
+
+        else if (args[0] == "trace")
+        {
+            if (args.size() > 2)
+                return "'trace' expects zero or one argument.";
+
+            const auto path = args.size() == 2 ? args[1] : toQString(cache_location / "trace.json");
+            QSaveFile file(path);
+            if (!file.open(QIODevice::WriteOnly)
+                || file.write(Trace::toChromeTrace()) < 0
+                || !file.commit())
+                return u"Failed to write trace: %1"_s.arg(file.errorString()).toUtf8();
+            return path.toUtf8();
+        }
+
         else if (args[0] == "reload")
 
             if (args.size() != 2)
@@ -470,8 +540,13 @@ int ALBERT_EXPORT run(int argc, char **argv)
             {"n", "no-autoload"},
             Application::tr("Do not implicitly load enabled plugins."));
 
+        auto opt_l = QCommandLineOption(
+            {"l", "log"},
+            Application::tr("Set the log sink. 'stdout' (default), 'journal' or a file path."),
+            Application::tr("sink"));
+
         QCommandLineParser parser;
-        parser.addOptions({opt_p, opt_n});
+        parser.addOptions({opt_p, opt_n, opt_l});
         parser.addVersionOption();
         parser.addHelpOption();
         parser.setApplicationDescription(Application::tr("Launch Albert."));
@@ -479,6 +554,9 @@ int ALBERT_EXPORT run(int argc, char **argv)
 
         config.additional_plugin_paths = parser.value(opt_p).split(',', Qt::SkipEmptyParts);
         config.load_enabled            = !parser.isSet(opt_n);
+
+        if (parser.isSet(opt_l) && !setLogSink(parser.value(opt_l)))
+            WARN << "Failed to open log sink:" << parser.value(opt_l);
     }
 
     // Initialize theme icon lookup
@@ -493,7 +571,9 @@ int ALBERT_EXPORT run(int argc, char **argv)
         DEBG << line;
 
     int return_value = [&] {
+        const auto tp = Trace::Clock::now();
         Application app(config);
+        Trace::record("app", "Application", {}, tp);
         return qApp->exec();
     }();
 
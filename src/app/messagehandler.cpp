@@ -1,47 +1,262 @@
-// Copyright (c) 2024 Manuel Schneider
+// Copyright (c) 2024-2026 Manuel Schneider
 
 #include "messagehandler.h"
-#include <QMessageBox>
+#include "mpscqueue.hpp"
+#include <QDateTime>
+#include <QFile>
 #include <QString>
 #include <QTime>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#if defined(Q_OS_WIN)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+using namespace Qt::StringLiterals;
+using namespace std::chrono;
+using namespace std;
+
+namespace
+{
+
+struct Entry
+{
+    QtMsgType type;
+    char category[32];
+    system_clock::time_point time;  // Not steady, the monotonic clock halts in suspend
+    QString message;
+};
+
+static bool isTerminal(FILE *file)
+{
+#if defined(Q_OS_WIN)
+    return _isatty(_fileno(file));
+#else
+    return isatty(fileno(file));
+#endif
+}
+
+///
+/// Writes log entries in a dedicated thread.
+///
+/// Callers enqueue debug and info messages. Formatting, encoding and I/O happen in the writer
+/// thread. Warnings and criticals are written synchronously along with the queued messages,
+/// such that the lines preceding a crash are not lost. Consumers of the queue hold the I/O
+/// mutex.
+///
+class Logger
+{
+public:
+
+    enum class Sink { Stdout, Journal, File };
+
+    Logger() : colored_(isTerminal(stdout)), writer_([this]{ write(); }) {}
+
+    void log(QtMsgType type, const char *category, const QString &message)
+    {
+        Entry entry{type, {}, system_clock::now(), message};
+        strncpy(entry.category, category ? category : "", sizeof(entry.category) - 1);
+        entry.category[sizeof(entry.category) - 1] = '\0';
+
+        if (type == QtWarningMsg || type == QtCriticalMsg || !running_.load())
+        {
+            lock_guard lock(io_mutex_);
+            drain();
+            format(entry);
+            fflush(file_);
+            return;
+        }
+
+        if (!queue_.push(::move(entry)))
+        {
+            dropped_.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+
+        // The writer may have exited meanwhile. Pairs with the fence in shutdown().
+        atomic_thread_fence(memory_order_seq_cst);
+        if (!running_.load())
+        {
+            flush();
+            return;
+        }
+
+        signal_.fetch_add(1);
+        if (waiting_.load())
+            signal_.notify_one();
+    }
+
+    /// Writes the queued entries in the calling thread.
+    void flush()
+    {
+        lock_guard lock(io_mutex_);
+        drain();
+        fflush(file_);
+    }
+
+    void shutdown()
+    {
+        if (running_.exchange(false))
+        {
+            atomic_thread_fence(memory_order_seq_cst);
+            signal_.fetch_add(1);
+            signal_.notify_one();
+            writer_.join();
+            flush();  // Entries pushed while the writer exited
+        }
+    }
+
+    bool setSink(Sink sink, const QString &path = {})
+    {
+        FILE *file = stdout;
+        if (sink == Sink::File && !(file = fopen(QFile::encodeName(path).constData(), "a")))
+            return false;
+
+        lock_guard lock(io_mutex_);
+        if (file_ != stdout)
+            fclose(file_);
+        file_ = file;
+        sink_ = sink;
+        colored_ = sink == Sink::Stdout && isTerminal(file);
+        return true;
+    }
+
+private:
+
+    void write()
+    {
+        for (;;)
+        {
+            const auto signal = signal_.load();
+            flush();
+
+            if (!running_.load(memory_order_acquire) && queue_.empty())
+                return;
+
+            waiting_ = true;
+            if (queue_.empty() && running_.load(memory_order_acquire))
+                signal_.wait(signal);
+            waiting_ = false;
+        }
+    }
+
+    // Requires io_mutex_
+    void drain()
+    {
+        if (const auto dropped = dropped_.exchange(0, memory_order_relaxed))
+            fprintf(file_, "%s\n", qPrintable(u"Log queue full, dropped %1 messages."_s
+                                                  .arg(dropped)));
+
+        Entry entry;
+        while (queue_.pop(entry))
+            format(entry);
+    }
+
+    // Requires io_mutex_
+    void format(const Entry &e)
+    {
+        const auto message = e.message.toLocal8Bit();
+
+        // The journal adds time stamps. Priorities as of sd-daemon(3).
+        if (sink_ == Sink::Journal)
+        {
+            static const char *priorities[] = {"<7>", "<4>", "<3>", "<2>", "<6>"};
+            fprintf(file_, "%s[%s] %s\n", priorities[e.type], e.category, message.constData());
+            return;
+        }
+
+        const auto ms = duration_cast<milliseconds>(e.time.time_since_epoch()).count();
+        const auto time = QDateTime::fromMSecsSinceEpoch(ms).time().toString().toLocal8Bit();
+
+        // Files and pipes get no escape sequences
+        if (!colored_)
+        {
+            static const char *levels[] = {"debg", "warn", "crit", "crit", "info"};
+            fprintf(file_, "%s [%s:%s] %s\n",
+                    time.constData(), levels[e.type], e.category, message.constData());
+            return;
+        }
+
+        // Todo use std::format as soon as apple gets it off the ground
+        switch (e.type) {
+        case QtDebugMsg:
+            fprintf(file_, "%s \x1b[34m[debg:%s]\x1b[0m %s\x1b[0m\n",
+                    time.constData(), e.category, message.constData());
+            break;
+        case QtInfoMsg:
+            fprintf(file_, "%s \x1b[32m[info:%s]\x1b[0m %s\n",
+                    time.constData(), e.category, message.constData());
+            break;
+        case QtWarningMsg:
+            fprintf(file_, "%s \x1b[33m[warn:%s]\x1b[0m %s\x1b[0m\n",
+                    time.constData(), e.category, message.constData());
+            break;
+        case QtCriticalMsg:
+        case QtFatalMsg:
+            fprintf(file_, "%s \x1b[31m[crit:%s] %s\x1b[0m\n",
+                    time.constData(), e.category, message.constData());
+            break;
+        }
+    }
+
+    MpscQueue<Entry, 4096> queue_;
+    atomic_uint dropped_ = 0;
+    atomic_uint signal_ = 0;  // Bumped on push, awaited by the writer
+    atomic_bool waiting_ = false;
+    atomic_bool running_ = true;
+
+    mutex io_mutex_;
+    FILE *file_ = stdout;
+    Sink sink_ = Sink::Stdout;
+    bool colored_;
+
+    thread writer_;  // Last, uses the members above
+};
+
+// Leaked, messages may be logged during static destruction
+Logger &logger()
+{
+    static auto *logger = [] {
+        auto *l = new Logger;
+        atexit([]{ ::logger().shutdown(); });
+        return l;
+    }();
+    return *logger;
+}
+
+}
 
 void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message)
 {
-    // Todo use std::format as soon as apple gets it off the ground
-    switch (type) {
-    case QtDebugMsg:
-        fprintf(stdout, "%s \x1b[34m[debg:%s]\x1b[0m %s\x1b[0m\n",
-                QTime::currentTime().toString().toLocal8Bit().constData(),
-                context.category,
-                message.toLocal8Bit().constData());
-        break;
-    case QtInfoMsg:
-        fprintf(stdout, "%s \x1b[32m[info:%s]\x1b[0m %s\n",
-                QTime::currentTime().toString().toLocal8Bit().constData(),
-                context.category,
-                message.toLocal8Bit().constData());
-
-        break;
-    case QtWarningMsg:
-        fprintf(stdout, "%s \x1b[33m[warn:%s]\x1b[0m %s\x1b[0m\n",
-                QTime::currentTime().toString().toLocal8Bit().constData(),
-                context.category,
-                message.toLocal8Bit().constData());
-        break;
-    case QtCriticalMsg:
-        fprintf(stdout, "%s \x1b[31m[crit:%s] %s\x1b[0m\n",
-                QTime::currentTime().toString().toLocal8Bit().constData(),
-                context.category,
-                message.toLocal8Bit().constData());
-        break;
-    case QtFatalMsg:
-        fprintf(stderr, "%s \x1b[41;30;4m[fatal:%s]\x1b[0;1m %s  --  [%s]\x1b[0m\n",
-                QTime::currentTime().toString().toLocal8Bit().constData(),
-                context.category,
-                message.toLocal8Bit().constData(),
-                context.function);
-        fflush(stdout);
-        std::abort();
-    }
-    fflush(stdout);
+    if (type != QtFatalMsg)
+    {
+        logger().log(type, context.category, message);
+        return;
+    }
+
+    // Write pending messages first, the process is about to abort
+    logger().flush();
+    fprintf(stderr, isTerminal(stderr) ? "%s \x1b[41;30;4m[fatal:%s]\x1b[0;1m %s  --  [%s]\x1b[0m\n"
+                                       : "%s [fatal:%s] %s  --  [%s]\n",
+            QTime::currentTime().toString().toLocal8Bit().constData(),
+            context.category,
+            message.toLocal8Bit().constData(),
+            context.function);
+    fflush(stderr);
+    std::abort();
+}
+
+bool setLogSink(const QString &sink)
+{
+    if (sink == u"stdout"_s)
+        return logger().setSink(Logger::Sink::Stdout);
+    else if (sink == u"journal"_s)
+        return logger().setSink(Logger::Sink::Journal);
+    else
+        return logger().setSink(Logger::Sink::File, sink);
 }
@@ -1,6 +1,10 @@
-// Copyright (c) 2024 Manuel Schneider
+// Copyright (c) 2024-2026 Manuel Schneider
 
 #pragma once
 #include <QString>
 
 void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message);
+
+/// Sets the sink of the log messages. Either "stdout", "journal" or a file path.
+/// Returns false if the file could not be opened.
+bool setLogSink(const QString &sink);
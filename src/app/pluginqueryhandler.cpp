@@ -118,6 +118,9 @@ QString PluginQueryHandler::description() const { return tr("Manage plugins"); }
 
 QString PluginQueryHandler::defaultTrigger() const { return u"plugin "_s; }
 
+// The items present the plugin state live, results depend on the index only
+uint PluginQueryHandler::resultGeneration() const { return indexGeneration(); }
+
 void PluginQueryHandler::updateIndexItems()
 {
     vector<IndexItem> items;
@@ -17,6 +17,7 @@ public:
     QString description() const override;
     QString defaultTrigger() const override;
     void updateIndexItems() override;
+    uint resultGeneration() const override;
 
 private:
     PluginRegistry &plugin_registry_;
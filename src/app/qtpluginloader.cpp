@@ -5,8 +5,11 @@
 #include "logging.h"
 #include "plugininstance.h"
 #include "qtpluginloader.h"
+#include "startuptrace.h"
+#include "threadpool.h"
 #include <QCoreApplication>
 #include <QFutureWatcher>
+#include <QJsonObject>
 #include <QPluginLoader>
 #include <QTranslator>
 #include <QtConcurrentRun>
@@ -35,15 +38,15 @@ static QString fetchLocalizedMetadata(const QJsonObject &json, const QString &ke
 }
 
 
-QtPluginLoader::QtPluginLoader(const QString &path)
-    : loader_(path)
+QtPluginLoader::QtPluginLoader(const QString &path, const QJsonObject &qt_metadata)
+    : path_(path)
     , instance_(nullptr)
 {
     //
     // Check interface
     //
 
-    auto iid = loader_.metaData().value("IID"_L1).toString();
+    auto iid = qt_metadata.value("IID"_L1).toString();
 
     if (iid.isEmpty())
         throw runtime_error("Not a Qt plugin");
@@ -81,7 +84,7 @@ QtPluginLoader::QtPluginLoader(const QString &path)
     // Extract metadata
     //
 
-    auto rawMetadata = loader_.metaData().value("MetaData"_L1).toObject();
+    auto rawMetadata = qt_metadata.value("MetaData"_L1).toObject();
 
     auto load_type = PluginMetadata::LoadType::User;
     if (auto lts = rawMetadata["loadtype"_L1].toString();
@@ -108,50 +111,22 @@ QtPluginLoader::QtPluginLoader(const QString &path)
         .plugin_dependencies  = rawMetadata["plugin_dependencies"_L1].toVariant().toStringList(),
         .third_party_credits  = rawMetadata["credits"_L1].toVariant().toStringList(),
         .platforms{},
+        .triggers             = rawMetadata["triggers"_L1].toVariant().toStringList(),
+        .handler_kinds        = rawMetadata["handlers"_L1].toVariant().toStringList(),
         .load_type = load_type
     };
-
-    //
-    // Set load hints
-    //
-    // ExportExternalSymbolsHint:
-    // Some python libs do not link against python. Export the python symbols to the main app.
-    // (this comment is like 10y old, TODO check if necessary)
-    //
-    // PreventUnloadHint:
-    // To be able to unload we have to make sure that there is no object of this library alive.
-    // This is nearly impossible with the current design. Frontends keep queries alive over
-    // sessions which then segfault on deletion when the code has been unloaded.
-    //
-    // TODO: Design something that ensures that no items/actions will be alive when plugins get
-    // unloaded. (e.g. Session class, owning queries, injected into frontends when shown).
-    //
-    // Anyway atm frontends keep queries alive over session, which is just poor design.
-    // However not unloading is an easy fix for now and theres more important stuff to do.
-    //
-    // Update 2024:
-    //
-    // Althought the design _does_ handle object lifetime correctly now the app still segfaults
-    // when unloading plugins. Probably due to qt internal connection handling. One example that
-    // proved to sefault guaranteed is the WeakDependency class whose connections (at least on
-    // macos) call into unloaded code although all connections have been properly disconnected.
-    //
-    // Probably this should be reported as a bug to Qt. But well, … PreventUnload
-    //
-
-    loader_.setLoadHints(QLibrary::ExportExternalSymbolsHint | QLibrary::PreventUnloadHint);
 }
 
 QtPluginLoader::~QtPluginLoader()
 {
-    if (loader_.isLoaded())
+    if (loader_ && loader_->isLoaded())
     {
         WARN << "QtPluginLoader destroyed in loaded state:" << metadata_.id;
         unload();
     }
 }
 
-QString QtPluginLoader::path() const { return loader_.fileName(); }
+QString QtPluginLoader::path() const { return path_; }
 
 const PluginMetadata &QtPluginLoader::metadata() const { return metadata_; }
 
@@ -167,25 +142,67 @@ void QtPluginLoader::load()
     // Plugins are expected to throw a localized message and print english logs using their
     // logging category.
 
-    auto future = QtConcurrent::run([&loader=loader_, id=metadata().id] -> unique_ptr<QTranslator> {
+    // The manifest provides the metadata. Do not touch the library file before it is loaded.
+    if (!loader_)
+    {
+        loader_ = make_unique<QPluginLoader>(path_);
+
+        //
+        // Set load hints
+        //
+        // ExportExternalSymbolsHint:
+        // Some python libs do not link against python. Export the python symbols to the main app.
+        // (this comment is like 10y old, TODO check if necessary)
+        //
+        // PreventUnloadHint:
+        // To be able to unload we have to make sure that there is no object of this library alive.
+        // This is nearly impossible with the current design. Frontends keep queries alive over
+        // sessions which then segfault on deletion when the code has been unloaded.
+        //
+        // TODO: Design something that ensures that no items/actions will be alive when plugins get
+        // unloaded. (e.g. Session class, owning queries, injected into frontends when shown).
+        //
+        // Anyway atm frontends keep queries alive over session, which is just poor design.
+        // However not unloading is an easy fix for now and theres more important stuff to do.
+        //
+        // Update 2024:
+        //
+        // Althought the design _does_ handle object lifetime correctly now the app still segfaults
+        // when unloading plugins. Probably due to qt internal connection handling. One example that
+        // proved to sefault guaranteed is the WeakDependency class whose connections (at least on
+        // macos) call into unloaded code although all connections have been properly disconnected.
+        //
+        // Probably this should be reported as a bug to Qt. But well, … PreventUnload
+        //
+
+        loader_->setLoadHints(QLibrary::ExportExternalSymbolsHint | QLibrary::PreventUnloadHint);
+    }
+
+    // Startup latency matters, do not queue behind indexing. Queries come first though.
+    auto future = runInteractive([&loader=*loader_, id=metadata().id] -> unique_ptr<QTranslator> {
 
         auto tp = now();
+        auto trace_tp = StartupTrace::Clock::now();
         if (!loader.load())
             throw runtime_error(loader.errorString().toStdString());
+        StartupTrace::record(id, StartupTrace::Phase::Library, trace_tp);
         DEBG << u"%1: Library loaded in %2 ms (%3)"_s
                     .arg(id).arg(diff<>(tp)).arg(loader.fileName());
 
+        // The translations are resources of the library. Other libraries load meanwhile.
         tp = now();
+        trace_tp = StartupTrace::Clock::now();
         if (auto translator = make_unique<QTranslator>();
             app().localizationEnabled() && translator->load(QLocale(), id, "_", ":/i18n"))
         {
+            StartupTrace::record(id, StartupTrace::Phase::Translations, trace_tp);
             DEBG << u"%1: Translations loaded in %2 ms (%3)"_s
                         .arg(id).arg(diff<>(tp)).arg(translator->filePath());
             return translator;
         }
         else
             return {};
-    })
+    }, TaskPriority::Low)
     .then(this, [this](unique_ptr<QTranslator> translator) {
         if (translator)
         {
@@ -195,13 +212,15 @@ void QtPluginLoader::load()
         }
 
         auto tp = now();
+        const auto trace_tp = StartupTrace::Clock::now();
         PluginLoader::current_loader = this;
-        auto *instance = loader_.instance();
+        auto *instance = loader_->instance();
         if (!instance)
             throw runtime_error("Plugin instance is null.");
         if (instance_ = dynamic_cast<PluginInstance *>(instance);
             !instance_)
             throw runtime_error("Plugin instance is not of type albert::PluginInstance.");
+        StartupTrace::record(metadata().id, StartupTrace::Phase::Instantiation, trace_tp);
         DEBG << u"%1: Instantiated in %2 ms"_s
                     .arg(metadata().id).arg(diff<>(tp));
         emit finished({});
@@ -227,10 +246,10 @@ void QtPluginLoader::load()
 
 void QtPluginLoader::unload()
 {
-    if (loader_.isLoaded())
+    if (loader_ && loader_->isLoaded())
     {
-        if (!loader_.unload())
-            WARN << u"%1: Unload failed: %2"_s.arg(metadata_.id, loader_.errorString());
+        if (!loader_->unload())
+            WARN << u"%1: Unload failed: %2"_s.arg(metadata_.id, loader_->errorString());
         else
             DEBG << u"%1: Unloaded."_s.arg(metadata_.id);
 
@@ -12,7 +12,9 @@ class QtPluginLoader final : public albert::PluginLoader
 {
 public:
 
-    QtPluginLoader(const QString &path);
+    /// Constructs a loader for the library at _path_ having the Qt plugin metadata _qt_metadata_.
+    /// @throws std::runtime_error if the metadata is not the one of a compatible albert plugin.
+    QtPluginLoader(const QString &path, const QJsonObject &qt_metadata);
     ~QtPluginLoader();
 
     QString path() const override;
@@ -23,7 +25,8 @@ public:
 
 private:
 
-    QPluginLoader loader_;
+    const QString path_;
+    std::unique_ptr<QPluginLoader> loader_;  // Created on load, it reads the library file
     albert::PluginMetadata metadata_;
     albert::PluginInstance *instance_;
     std::unique_ptr<QTranslator> translator_;
@@ -3,15 +3,126 @@
 #include "logging.h"
 #include "qtpluginloader.h"
 #include "qtpluginprovider.h"
+#include "trace.h"
 #include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
 #include <QDirIterator>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPluginLoader>
+#include <QSaveFile>
+#include <albert/app.h>
+#include <map>
 #include <ranges>
+#if defined(Q_OS_UNIX)
+#include <sys/stat.h>
+#endif
+using namespace Qt::StringLiterals;
 using namespace albert;
 using namespace std;
 
+namespace
+{
+static const quint32 manifest_magic = 0x616c6270;  // "albp"
+static const quint32 manifest_version = 2;
+static const char *manifest_file_name = "plugin-manifest.cache";
+
+struct FileKey
+{
+    qint64 mtime;
+    qint64 size;
+    quint64 inode;  // Package managers replace files
+    bool operator==(const FileKey &) const = default;
+};
+
+struct ManifestEntry
+{
+    FileKey key;
+    QJsonObject qt_metadata;  // Empty for libraries that are not Qt plugins
+};
+
+using Manifest = map<QString, ManifestEntry>;  // By path
+}
+
+static FileKey fileKey(const QString &path)
+{
+#if defined(Q_OS_UNIX)
+    if (struct stat st; ::stat(QFile::encodeName(path).constData(), &st) == 0)
+    {
+        // Millisecond resolution, rebuilds within a second must not be missed
+#if defined(Q_OS_MAC)
+        const auto &mtime = st.st_mtimespec;
+#else
+        const auto &mtime = st.st_mtim;
+#endif
+        return {(qint64)mtime.tv_sec * 1000 + mtime.tv_nsec / 1000000,
+                (qint64)st.st_size, (quint64)st.st_ino};
+    }
+#endif
+    const QFileInfo fi(path);
+    return {fi.lastModified().toMSecsSinceEpoch(), fi.size(), 0};
+}
+
+static QString manifestFilePath()
+{ return QDir(app().cacheLocation()).filePath(manifest_file_name); }
+
+static Manifest loadManifest()
+{
+    Manifest manifest;
+    QFile file(manifestFilePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return manifest;
+
+    QDataStream s(&file);
+    quint32 magic, version, count;
+    s >> magic >> version >> count;
+    if (magic != manifest_magic || version != manifest_version)
+        return manifest;
+
+    for (quint32 i = 0; i < count && s.status() == QDataStream::Ok; ++i)
+    {
+        QString path;
+        ManifestEntry entry;
+        QByteArray json;
+        s >> path >> entry.key.mtime >> entry.key.size >> entry.key.inode >> json;
+        entry.qt_metadata = QJsonDocument::fromJson(json).object();
+        manifest.emplace(::move(path), ::move(entry));
+    }
+
+    if (s.status() != QDataStream::Ok)
+    {
+        WARN << "Plugin manifest cache is corrupt.";
+        manifest.clear();
+    }
+
+    return manifest;
+}
+
+static void saveManifest(const Manifest &manifest)
+{
+    QSaveFile file(manifestFilePath());
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        WARN << u"Failed to write plugin manifest cache: %1"_s.arg(file.errorString());
+        return;
+    }
+
+    QDataStream s(&file);
+    s << manifest_magic << manifest_version << (quint32)manifest.size();
+    for (const auto &[path, entry] : manifest)
+        s << path << entry.key.mtime << entry.key.size << entry.key.inode
+          << QJsonDocument(entry.qt_metadata).toJson(QJsonDocument::Compact);
+
+    if (!file.commit())
+        WARN << u"Failed to write plugin manifest cache: %1"_s.arg(file.errorString());
+}
+
 
 QtPluginProvider::QtPluginProvider(QStringList paths)
 {
+    Trace::Span span("plugin", "scan");
+
 #if defined(Q_OS_MAC)
     paths << "../../../../lib";  // ./bin/albert.app/Contents/MacOS/
 #elif defined(Q_OS_UNIX)
@@ -44,20 +155,46 @@ QtPluginProvider::QtPluginProvider(QStringList paths)
             unique_canonical_paths << pfi.canonicalFilePath();
     unique_canonical_paths.removeDuplicates();
 
+    // Reading the metadata of a library opens and parses it. Unchanged files use the cache.
+    const auto manifest = loadManifest();
+    Manifest new_manifest;
+    uint probed = 0;
+
     INFO << "Searching native plugins in" << unique_canonical_paths.join(", ");
     for (const auto &path : as_const(unique_canonical_paths))
     {
         QDirIterator dirIterator(path, QDir::Files);
         while (dirIterator.hasNext()) {
+            const auto file_path = QFileInfo(dirIterator.next()).absoluteFilePath();
+
+            ManifestEntry entry{fileKey(file_path), {}};
+            if (const auto it = manifest.find(file_path);
+                it != manifest.end() && it->second.key == entry.key)
+                entry.qt_metadata = it->second.qt_metadata;
+            else
+            {
+                entry.qt_metadata = QPluginLoader(file_path).metaData();
+                ++probed;
+            }
+
             try {
-                auto pl = make_unique<QtPluginLoader>(QFileInfo(dirIterator.next()).absoluteFilePath());
+                auto pl = make_unique<QtPluginLoader>(file_path, entry.qt_metadata);
                 DEBG << "Found valid native plugin" << pl->path();
                 plugin_loaders_.emplace_back(::move(pl));
             } catch (const runtime_error &e) {
-                DEBG << dirIterator.filePath() << e.what();
+                DEBG << file_path << e.what();
             }
+
+            new_manifest.emplace(file_path, ::move(entry));
         }
     }
+
+    // Also drops removed files
+    if (probed > 0 || new_manifest.size() != manifest.size())
+    {
+        DEBG << u"Probed %1 of %2 libraries"_s.arg(probed).arg(new_manifest.size());
+        saveManifest(new_manifest);
+    }
 }
 
 QtPluginProvider::~QtPluginProvider() = default;
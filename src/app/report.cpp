@@ -1,5 +1,6 @@
 // Copyright (c) 2023-2024 Manuel Schneider
 
+#include "startuptrace.h"
 #include <QApplication>
 #include <QDir>
 #include <QFont>
@@ -49,6 +50,13 @@ QStringList report()
     sl << fmt("Working dir",           QDir::currentPath());
     sl << fmt("Arguments",             QApplication::arguments().join(" "));
 
+    // PLUGINS
+    if (const auto startup = StartupTrace::report(); !startup.isEmpty())
+    {
+        sl << "PLUGIN STARTUP:";
+        sl << startup;
+    }
+
     // ENVIRONMENT
     sl << "ENVIRONMENT:";
     for (auto env = QProcessEnvironment::systemEnvironment();
@@ -1,7 +1,11 @@
 // Copyright (c) 2023-2025 Manuel Schneider
 
 #include "item.h"
+#include <QCoreApplication>
+#include <mutex>
 #include <set>
+#include <unordered_set>
+#include <vector>
 using namespace albert;
 
 Item::~Item() {}
@@ -10,6 +14,8 @@ QString Item::inputActionText() const { return text(); }
 
 std::vector<Action> Item::actions() const { return {}; }
 
+QString Item::identity() const { return {}; }
+
 void Item::addObserver(Item::Observer*) {}
 
 void Item::removeObserver(Item::Observer*) {}
@@ -21,22 +27,102 @@ Item::Observer::~Observer() = default;
 class detail::DynamicItem::Private
 {
 public:
-    std::set<Item::Observer*> observers;
+    Private(const DynamicItem *i) : item(i) {}
+    const DynamicItem *item;
+    std::set<Item::Observer*> observers;  // Guarded by the hub mutex
+};
+
+// Collects changed items and notifies their observers once per event loop pass in the main thread
+class detail::ItemChangeHub
+{
+public:
+    static ItemChangeHub &instance()
+    {
+        static ItemChangeHub hub;
+        return hub;
+    }
+
+    void markDirty(DynamicItem::Private *item)
+    {
+        std::lock_guard lock(mutex);
+        dirty.insert(item);
+
+        // Retried on the next change if there is no application yet
+        if (!flush_scheduled)
+            if (auto *app = QCoreApplication::instance())
+                flush_scheduled = QMetaObject::invokeMethod(app, [this]{ flush(); },
+                                                            Qt::QueuedConnection);
+    }
+
+    void forget(DynamicItem::Private *item)
+    {
+        std::lock_guard lock(mutex);
+        dirty.erase(item);
+        notifying.erase(item);
+        if (current == item)
+            current = nullptr;
+    }
+
+    void addObserver(DynamicItem::Private *item, Item::Observer *observer)
+    {
+        std::lock_guard lock(mutex);
+        item->observers.insert(observer);
+    }
+
+    void removeObserver(DynamicItem::Private *item, Item::Observer *observer)
+    {
+        std::lock_guard lock(mutex);
+        item->observers.erase(observer);
+    }
+
+private:
+
+    void flush()
+    {
+        // Notify without the lock. Observers may take their own locks, change items, remove
+        // observers or delete items. Items and observers are re-checked before each call.
+        std::unique_lock lock(mutex);
+        flush_scheduled = false;
+        notifying.merge(dirty);
+        dirty.clear();
+
+        while (!notifying.empty())
+        {
+            current = notifying.extract(notifying.begin()).value();
+            const Item *item = current->item;
+            const std::vector<Item::Observer*> observers(current->observers.begin(),
+                                                         current->observers.end());
+            for (auto *observer : observers)
+            {
+                if (!current)
+                    break;  // Item deleted
+                if (!current->observers.contains(observer))
+                    continue;  // Observer removed
+                lock.unlock();
+                observer->onItemChanged(item);
+                lock.lock();
+            }
+        }
+        current = nullptr;
+    }
+
+    std::mutex mutex;
+    std::unordered_set<DynamicItem::Private*> dirty;
+    std::unordered_set<DynamicItem::Private*> notifying;  // Dirty items of the running flush
+    DynamicItem::Private *current = nullptr;  // Notified right now, reset if deleted
+    bool flush_scheduled = false;
 };
 
 detail::DynamicItem::DynamicItem() :
-    d(std::make_unique<detail::DynamicItem::Private>())
+    d(std::make_unique<detail::DynamicItem::Private>(this))
 {}
 
-detail::DynamicItem::~DynamicItem() {}
-
-void detail::DynamicItem::dataChanged() const
-{
-    for (auto observer : d->observers)
-        observer->onItemChanged(this);
-}
+detail::DynamicItem::~DynamicItem() { ItemChangeHub::instance().forget(d.get()); }
 
-void detail::DynamicItem::addObserver(Item::Observer *o) { d->observers.insert(o); }
+void detail::DynamicItem::dataChanged() const { ItemChangeHub::instance().markDirty(d.get()); }
 
-void detail::DynamicItem::removeObserver(Item::Observer *o) { d->observers.erase(o); }
+void detail::DynamicItem::addObserver(Item::Observer *o)
+{ ItemChangeHub::instance().addObserver(d.get(), o); }
 
+void detail::DynamicItem::removeObserver(Item::Observer *o)
+{ ItemChangeHub::instance().removeObserver(d.get(), o); }
@@ -19,12 +19,26 @@ Session::Session(QueryEngine &e, Frontend &f) : engine_(e), frontend_(f)
 Session::~Session()
 {
     frontend_.setQuery(nullptr);
+    for (auto &query : queries_)
+        engine_.retire(::move(query));
+    engine_.discardSpeculations();
 }
 
 void Session::runQuery(const QString &query_string)
 {
     if(!queries_.empty())
-        queries_.back()->execution().cancel();
-    auto &q = queries_.emplace_back(engine_.query(query_string));
+        queries_.back()->cancel();
+
+    // The frontend may keep displaying the previous query until the new one has results.
+    // Anything older is unreferenced. Hand it to the engine to be deleted once inactive.
+    while (queries_.size() > 1)
+    {
+        engine_.retire(::move(queries_.front()));
+        queries_.erase(queries_.begin());
+    }
+    auto query = engine_.adoptSpeculation(query_string);
+    if (!query)
+        query = engine_.query(query_string);
+    auto &q = queries_.emplace_back(::move(query));
     frontend_.setQuery(q.get());
 }
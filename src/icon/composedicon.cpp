@@ -74,6 +74,16 @@ unique_ptr<Icon> ComposedIcon::clone() const
                                      y2_);
 }
 
+QString ComposedIcon::cacheKey()
+{
+    // Sources without key may render differently later
+    const auto key1 = src1_ ? src1_->cacheKey() : QString{};
+    const auto key2 = src2_ ? src2_->cacheKey() : QString{};
+    if (key1.isEmpty() || key2.isEmpty())
+        return {};
+    return u"%1|%2|%3"_s.arg(toUrl(), key1, key2);
+}
+
 QString ComposedIcon::toUrl() const
 {
     QString url = u"%1:?src1=%2&src2=%3"_s.arg(scheme(),
@@ -21,6 +21,9 @@ unique_ptr<Icon> FileTypeIcon::clone() const { return make_unique<FileTypeIcon>(
 
 QString FileTypeIcon::toUrl() const { return u"%1:%2"_s.arg(scheme(), path_); }
 
+// Rendered by the current theme
+QString FileTypeIcon::cacheKey() { return u"%1|%2"_s.arg(toUrl(), QIcon::themeName()); }
+
 QString FileTypeIcon::scheme() { return u"qfip"_s; }
 
 unique_ptr<FileTypeIcon> FileTypeIcon::fromUrl(const QString &url)
@@ -14,6 +14,7 @@ public:
 
     std::unique_ptr<Icon> clone() const override;
     QString toUrl() const override;
+    QString cacheKey() override;
 
     static std::unique_ptr<FileTypeIcon> fromUrl(const QString &url);
     static QString scheme();
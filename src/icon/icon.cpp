@@ -5,6 +5,7 @@
 #include "filetypeicon.h"
 #include "graphemeicon.h"
 #include "iconifiedicon.h"
+#include "iconloader.h"
 #include "imageicon.h"
 #include "logging.h"
 #include "qiconengineadapter.h"
@@ -31,6 +32,8 @@ QPixmap Icon::pixmap(const QSize &device_independent_size, qreal device_pixel_ra
     pm.setDevicePixelRatio(device_pixel_ratio);
     pm.fill(Qt::transparent);
 
+    // Pixmaps are not repainted, e.g. cached or set on labels. Do not paint placeholders.
+    IconLoader::BlockingScope blocking;
     QPainter p(&pm);
     paint(&p, QRect(QPoint(0,0), actual_device_independent_size));
 
@@ -119,6 +119,15 @@ unique_ptr<Icon> IconifiedIcon::clone() const
                                       border_brush_);
 }
 
+QString IconifiedIcon::cacheKey()
+{
+    // Sources without key may render differently later
+    const auto key = src_ ? src_->cacheKey() : QString{};
+    if (key.isEmpty())
+        return {};
+    return u"%1|%2"_s.arg(toUrl(), key);
+}
+
 QString IconifiedIcon::toUrl() const
 {
     QString url = u"%1:?src=%2"_s.arg(scheme(), percentEncoded(src_->toUrl()));
@@ -23,6 +23,7 @@ public:
     bool isNull() override;
     std::unique_ptr<Icon> clone() const override;
     QString toUrl() const override;
+    QString cacheKey() override;
 
     static std::unique_ptr<IconifiedIcon> fromUrl(const QString &url);
     static QString scheme();
@@ -0,0 +1,108 @@
+// SPDX-FileCopyrightText: 2026 Manuel Schneider
+
+#include "iconloader.h"
+#include "logging.h"
+#include "threadpool.h"
+#include "trace.h"
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QImageReader>
+using namespace Qt::StringLiterals;
+using namespace albert;
+using namespace std;
+
+namespace
+{
+static const int cache_size = 32 * 1024;  // KiB
+thread_local bool blocking = false;
+}
+
+IconLoader::BlockingScope::BlockingScope() : previous_(exchange(blocking, true)) {}
+
+IconLoader::BlockingScope::~BlockingScope() { blocking = previous_; }
+
+IconLoader::IconLoader() : cache_(cache_size)
+{
+    // Lazily created, possibly in a worker thread
+    if (auto *app = QCoreApplication::instance())
+        moveToThread(app->thread());
+}
+
+IconLoader &IconLoader::instance()
+{
+    static IconLoader loader;
+    return loader;
+}
+
+optional<QImage> IconLoader::image(const QString &path, const QSize &size)
+{
+    const auto key = u"%1@%2x%3"_s.arg(path).arg(size.width()).arg(size.height());
+
+    {
+        lock_guard lock(mutex_);
+
+        if (auto *image = cache_.object(key))
+            return *image;
+
+        if (!pending_.insert(key).second && !blocking)
+            return {};  // Already scheduled
+    }
+
+    // Resources are in memory, no need to defer
+    if (blocking || path.startsWith(u':'))
+    {
+        auto image = decode(path, size);
+        store(key, image);
+        return image;
+    }
+
+    runInBackground([this, key, path, size] {
+        store(key, decode(path, size));
+
+        bool notify;
+        {
+            lock_guard lock(mutex_);
+            if (!loaded_.contains(path))
+                loaded_ << path;
+            notify = !exchange(notify_scheduled_, true);
+        }
+
+        if (notify)
+            QMetaObject::invokeMethod(this, [this] {
+                QStringList paths;
+                {
+                    lock_guard lock(mutex_);
+                    notify_scheduled_ = false;
+                    swap(paths, loaded_);
+                }
+                emit loaded(paths);
+            }, Qt::QueuedConnection);
+    }, TaskPriority::High);
+
+    return {};
+}
+
+QImage IconLoader::decode(const QString &path, const QSize &size)
+{
+    Trace::Span span("icon", "decode", QFileInfo(path).suffix());  // Paths are user data
+    QImageReader reader(path);
+
+    // Scale vector graphics to fit, scale raster graphics down only, like QIcon does.
+    if (const auto image_size = reader.size(); !image_size.isValid())
+        reader.setScaledSize(size);
+    else if (reader.format().startsWith("svg")
+             || image_size.width() > size.width() || image_size.height() > size.height())
+        reader.setScaledSize(image_size.scaled(size, Qt::KeepAspectRatio));
+
+    auto image = reader.read();
+    if (image.isNull())
+        WARN << u"Failed to decode image '%1': %2"_s.arg(path, reader.errorString());
+    return image;
+}
+
+void IconLoader::store(const QString &key, const QImage &image)
+{
+    lock_guard lock(mutex_);
+    pending_.erase(key);
+    cache_.insert(key, new QImage(image), max<qsizetype>(1, image.sizeInBytes() / 1024));
+}
@@ -0,0 +1,70 @@
+// SPDX-FileCopyrightText: 2026 Manuel Schneider
+
+#pragma once
+#include <QCache>
+#include <QImage>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <mutex>
+#include <optional>
+#include <set>
+
+///
+/// Decodes images in the background thread pool and caches the results.
+///
+/// This class is thread-safe.
+///
+class IconLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    ///
+    /// Makes \ref image decode synchronously in the current thread while alive.
+    ///
+    /// For consumers that are not repainted when \ref loaded is emitted, e.g. rendered pixmaps.
+    ///
+    class BlockingScope
+    {
+    public:
+        BlockingScope();
+        ~BlockingScope();
+    private:
+        const bool previous_;
+    };
+
+    static IconLoader &instance();
+
+    ///
+    /// Returns the image at _path_ decoded to fit into _size_ (device pixels) if cached.
+    ///
+    /// Otherwise schedules decoding and returns `std::nullopt`. \ref loaded is emitted when done.
+    /// Images failed to decode are cached as null images. Resources and images requested in a
+    /// \ref BlockingScope are decoded synchronously.
+    ///
+    std::optional<QImage> image(const QString &path, const QSize &size);
+
+signals:
+
+    ///
+    /// Emitted in the main thread when scheduled images have been decoded.
+    ///
+    /// Coalesced, _paths_ are the distinct paths decoded since the last emission.
+    ///
+    void loaded(const QStringList &paths);
+
+private:
+
+    IconLoader();
+    static QImage decode(const QString &path, const QSize &size);
+    void store(const QString &key, const QImage &image);
+
+    std::mutex mutex_;
+    QCache<QString, QImage> cache_;  // Cost in KiB
+    std::set<QString> pending_;
+    QStringList loaded_;  // Not yet notified
+    bool notify_scheduled_ = false;
+
+};
@@ -1,17 +1,17 @@
-// SPDX-FileCopyrightText: 2022-2025 Manuel Schneider
+// SPDX-FileCopyrightText: 2022-2026 Manuel Schneider
 
+#include "iconloader.h"
 #include "imageicon.h"
 #include "systemutil.h"
 #include <QFile>
+#include <QPainter>
 using namespace Qt::StringLiterals;
 using namespace albert;
 using namespace std;
 
-// TODO use imageloader
-
 ImageIcon::ImageIcon(const QString &path)
-    : QIconIcon(QFile::exists(path) ? QIcon(path) : QIcon())  // QIcon produces non null icons from non existing files
-    , path_(path)
+    : path_(path)
+    , exists_(QFile::exists(path))  // Decoding is deferred, but fallback icons need this early
 {}
 
 ImageIcon::ImageIcon(const filesystem::path &path)
@@ -22,6 +22,27 @@ unique_ptr<Icon> ImageIcon::clone() const { return make_unique<ImageIcon>(*this)
 
 QString ImageIcon::toUrl() const { return u"%1:%2"_s.arg(fileScheme(), path_); }
 
+// Pixmaps are rendered in a blocking scope, they never contain placeholders
+QString ImageIcon::cacheKey() { return toUrl(); }
+
+void ImageIcon::paint(QPainter *painter, const QRect &rect)
+{
+    if (!exists_)
+        return;
+
+    const qreal dpr = painter->device() ? painter->device()->devicePixelRatio() : 1.;
+    const auto image = IconLoader::instance().image(path_, rect.size() * dpr);
+    if (!image || image->isNull())
+        return;  // Placeholder, the loader notifies when the image is ready
+
+    QRectF target(QPointF(), QSizeF(image->size()) / dpr);
+    target.moveCenter(QRectF(rect).center());
+    painter->setRenderHint(QPainter::SmoothPixmapTransform);
+    painter->drawImage(target, *image);
+}
+
+bool ImageIcon::isNull() { return !exists_; }
+
 QString ImageIcon::fileScheme() { return u"file"_s; }
 
 QString ImageIcon::qrcScheme() { return u"qrc"_s; }
@@ -1,12 +1,18 @@
-// SPDX-FileCopyrightText: 2022-2025 Manuel Schneider
+// SPDX-FileCopyrightText: 2022-2026 Manuel Schneider
 
 #pragma once
-#include "qiconicon.h"
+#include "icon.h"
 #include <filesystem>
 
 namespace albert {
 
-class ALBERT_EXPORT ImageIcon : public QIconIcon
+///
+/// Image file icon.
+///
+/// Images are decoded asynchronously by the IconLoader. Until then \ref paint paints nothing.
+/// Pixmaps and QIcons decode synchronously.
+///
+class ALBERT_EXPORT ImageIcon : public Icon
 {
 public:
     ImageIcon(const QString &path);
@@ -14,6 +20,9 @@ public:
 
     std::unique_ptr<Icon> clone() const override;
     QString toUrl() const override;
+    QString cacheKey() override;
+    void paint(QPainter*, const QRect&) override;
+    bool isNull() override;
 
     static std::unique_ptr<ImageIcon> fromUrl(const QString &url);
     static QString fileScheme();
@@ -23,6 +32,7 @@ public:
 
 private:
     QString path_;
+    bool exists_;
 };
 
 } // namespace albert
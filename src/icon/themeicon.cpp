@@ -26,6 +26,9 @@ unique_ptr<Icon> ThemeIcon::clone() const { return make_unique<ThemeIcon>(*this)
 
 QString ThemeIcon::toUrl() const { return u"%1:%2"_s.arg(scheme(), name_); }
 
+// Rendered by the current theme
+QString ThemeIcon::cacheKey() { return u"%1|%2"_s.arg(toUrl(), QIcon::themeName()); }
+
 QString ThemeIcon::scheme() { return u"xdg"_s; }
 
 unique_ptr<ThemeIcon> ThemeIcon::fromUrl(const QString &url)
@@ -12,6 +12,8 @@ using namespace std;
 
 void platform::initPlatform(){}
 
+void platform::deinitPlatform(){}
+
 void platform::initNativeWindow(unsigned long long wid)
 {
     NSView *nsview = (__bridge NSView *)reinterpret_cast<void *>(wid);
@@ -8,6 +8,9 @@ namespace platform
 
 void initPlatform();
 
+/// Releases platform services. Called before the application shuts down its thread pools.
+void deinitPlatform();
+
 void initNativeWindow(unsigned long long wid);
 
 /// Runs an AppleScript and returns the result. Throws runtime_error on failure.
@@ -1,39 +1,113 @@
-// Copyright (c) 2024-2024 Manuel Schneider
+// Copyright (c) 2024-2026 Manuel Schneider
 
 #include "desktopentryparser.h"
 #include <QFile>
 #include <albert/logging.h>
+#include <algorithm>
+#include <cstring>
 using namespace Qt::StringLiterals;
 using namespace albert::detail;
 using namespace std;
 
+static string_view trimmed(string_view s)
+{
+    const auto first = s.find_first_not_of(" \t\r");
+    if (first == string_view::npos)
+        return {};
+    return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+static inline string_view view(const QByteArray &bytes) { return {bytes.constData(), (size_t)bytes.size()}; }
+
 DesktopEntryParser::DesktopEntryParser(const QString &path)
 {
-    if (QFile file(path); file.open(QIODevice::ReadOnly| QIODevice::Text))
+    // Not memory mapped. Package upgrades truncate files while they are read, which raises
+    // SIGBUS on mappings. Desktop entries are small anyway.
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        throw runtime_error(u"Failed opening file '%1': %2"_s
+                                .arg(path, file.errorString()).toStdString());
+    buffer = file.readAll();
+    parse(view(buffer));
+}
+
+QByteArray DesktopEntryParser::toBytes() const
+{
+    QByteArray bytes;
+    for (const auto &section : sections)
     {
-        QTextStream stream(&file);
-        QString currentGroup;
-        for (QString line=stream.readLine(); !line.isNull(); line=stream.readLine())
-        {
-            line = line.trimmed();
+        bytes.append('[').append(section.name).append("]\n");
+        for (const auto &entry : section.entries)
+            bytes.append(entry.key).append('=').append(entry.value).append('\n');
+    }
+    return bytes;
+}
 
-            if (line.startsWith(u'#') || line.isEmpty())
-                continue;
+DesktopEntryParser DesktopEntryParser::fromBytes(QByteArray contents)
+{
+    DesktopEntryParser parser;
+    parser.buffer = ::move(contents);
+    parser.parse(view(parser.buffer));
+    return parser;
+}
 
-            if (line.startsWith(u"["))
-            {
-                currentGroup = line.mid(1,line.size()-2).trimmed();
-                continue;
-            }
+void DesktopEntryParser::parse(string_view bytes)
+{
+    // Localizations of other locales are never read, see getLocaleString
+    const auto locale_name = locale.name().toUtf8();
+    const auto locale_lang = locale_name.left(locale_name.indexOf('_'));
+
+    // memchr is vectorized by the C library
+    for (const char *it = bytes.data(), *end = it + bytes.size(); it < end;)
+    {
+        const auto *eol = static_cast<const char*>(memchr(it, '\n', end - it));
+        if (!eol)
+            eol = end;
+        const auto line = trimmed({it, (size_t)(eol - it)});
+        it = eol + 1;
+
+        if (line.empty() || line.front() == '#')
+            continue;
 
-            data[currentGroup].emplace(line.section(u'=', 0,0).trimmed(),
-                                       line.section(u'=', 1, -1).trimmed());
+        if (line.front() == '[')
+        {
+            sections.emplace_back(trimmed(line.substr(1, line.size() - 2)));
+            continue;
         }
-        file.close();
+
+        if (sections.empty())
+            sections.emplace_back();
+
+        string_view key = line, value;
+        if (const auto eq = line.find('='); eq != string_view::npos)
+        {
+            key = trimmed(line.substr(0, eq));
+            value = trimmed(line.substr(eq + 1));
+        }
+
+        if (key.ends_with(']'))
+            if (const auto open = key.find('['); open != string_view::npos)
+                if (const auto lc = key.substr(open + 1, key.size() - open - 2);
+                    lc != view(locale_name) && lc != view(locale_lang))
+                    continue;
+
+        sections.back().entries.emplace_back(key, value);
     }
-    else
-        throw runtime_error(u"Failed opening file '%1': %2"_s
-                                .arg(path, file.errorString()).toStdString());
+}
+
+optional<string_view> DesktopEntryParser::find(const QString &section, const QString &key) const
+{
+    const auto s = section.toUtf8();
+    const auto k = key.toUtf8();
+
+    // Like a map with first key wins
+    for (const auto &sec : sections)
+        if (sec.name == view(s))
+            for (const auto &entry : sec.entries)
+                if (entry.key == view(k))
+                    return entry.value;
+
+    return nullopt;
 }
 
 QString DesktopEntryParser::getRawValue(const QString &section, const QString &key) const
@@ -41,25 +115,23 @@ QString DesktopEntryParser::getRawValue(const QString &section, const QString &k
     class SectionDoesNotExist : public std::out_of_range { using out_of_range::out_of_range; };
     class KeyDoesNotExist : public std::out_of_range { using out_of_range::out_of_range; };
 
-    try {
-        auto &s = data.at(section);
-        try {
-            return s.at(key);
-        } catch (const out_of_range&) {
-            throw KeyDoesNotExist(u"Section '%1' does not contain a key '%2'."_s
-                                      .arg(section, key).toStdString());
-        }
-    } catch (const out_of_range&) {
+    if (const auto value = find(section, key))
+        return QString::fromUtf8(value->data(), value->size());
+
+    const auto s = section.toUtf8();
+    if (ranges::any_of(sections, [&](const auto &sec){ return sec.name == view(s); }))
+        throw KeyDoesNotExist(u"Section '%1' does not contain a key '%2'."_s
+                                  .arg(section, key).toStdString());
+    else
         throw SectionDoesNotExist(u"Desktop entry does not contain a section '%1'."_s
                                       .arg(section).toStdString());
-    }
 }
 
-QString DesktopEntryParser::getEscapedValue(const QString &section, const QString &key) const
+QString DesktopEntryParser::unescape(const QString &unescaped)
 {
     QString result;
+    result.reserve(unescaped.size());
 
-    auto unescaped = getRawValue(section, key);
     for (auto it = unescaped.cbegin(); it != unescaped.cend();)
     {
         if (*it == u'\\'){
@@ -85,6 +157,11 @@ QString DesktopEntryParser::getEscapedValue(const QString &section, const QStrin
     return result;
 }
 
+QString DesktopEntryParser::getEscapedValue(const QString &section, const QString &key) const
+{
+    return unescape(getRawValue(section, key));
+}
+
 QString DesktopEntryParser::getString(const QString &section, const QString &key) const
 {
     return getEscapedValue(section, key);
@@ -98,24 +175,21 @@ QString DesktopEntryParser::getLocaleString(const QString &section, const QStrin
     // TODO: Properly fetch the localestring
     //       (lang_COUNTRY@MODIFIER, lang_COUNTRY, lang@MODIFIER, lang, default value)
 
-    try {
-        return getEscapedValue(section, u"%1[%2]"_s.arg(key, locale.name()));
-    } catch (const out_of_range&) { }
-
-    try {
-        return getEscapedValue(section, u"%1[%2]"_s.arg(key, locale.name().left(2)));
-    } catch (const out_of_range&) { }
+    const auto locale_name = locale.name();
+    for (const auto &variant : {locale_name, locale_name.section(u'_', 0, 0)})
+        if (const auto value = find(section, u"%1[%2]"_s.arg(key, variant)))
+            return unescape(QString::fromUtf8(value->data(), value->size()));
 
-    QString unlocalized = getEscapedValue(section, key);
+    QString unlocalized = getEscapedValue(section, key);  // throws
 
-    try {
-        auto domain = getEscapedValue(section, u"X-Ubuntu-Gettext-Domain"_s);
+    if (const auto domain = find(section, u"X-Ubuntu-Gettext-Domain"_s))
+    {
+        const auto d = unescape(QString::fromUtf8(domain->data(), domain->size())).toUtf8();
         // The resulting string is statically allocated and must not be modified or freed
         // Returns msgid on lookup failure
         // https://linux.die.net/man/3/dgettext
-        return QString::fromUtf8(dgettext(domain.toStdString().c_str(),
-                                          unlocalized.toStdString().c_str()));
-    } catch (const out_of_range&) { }
+        return QString::fromUtf8(dgettext(d.constData(), unlocalized.toUtf8().constData()));
+    }
 
     return unlocalized;
 }
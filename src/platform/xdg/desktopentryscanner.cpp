@@ -0,0 +1,289 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "backgroundexecutor.h"
+#include "desktopentryscanner.h"
+#include "logging.h"
+#include "threadpool.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QLocale>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QtConcurrentMap>
+#include <albert/app.h>
+#include <chrono>
+using namespace Qt::StringLiterals;
+using namespace albert::detail;
+using namespace albert;
+using namespace std;
+
+namespace
+{
+static const quint32 cache_magic = 0x616c6264;  // "albd"
+static const quint32 cache_version = 1;
+static const char *cache_file_name = "desktop-entries.cache";
+static const auto rescan_delay = chrono::milliseconds(1000);  // Package managers write in bursts
+static albert::detail::DesktopEntryScanner *scanner = nullptr;  // See shutdown()
+
+struct CachedFile
+{
+    QString id;
+    qint64 mtime;
+    qint64 size;
+    QByteArray contents;  // Parsed, see DesktopEntryParser::toBytes
+    shared_ptr<DesktopEntryParser> parser;
+};
+
+struct ScanResult
+{
+    map<QString, CachedFile> files;  // By path
+    QStringList directories;  // To watch
+};
+
+struct Listing
+{
+    QStringList directories;
+    vector<pair<QString, QString>> files;  // Desktop file id, path
+};
+}
+
+class DesktopEntryScanner::Private
+{
+public:
+    DesktopEntryScanner *q;
+    map<QString, CachedFile> files;  // By path
+    map<QString, Entry> entries;  // By id
+    BackgroundExecutor<ScanResult> executor;
+    QFileSystemWatcher watcher;
+    QTimer rescan_timer;
+
+    static QString cacheFilePath()
+    { return QDir(app().cacheLocation()).filePath(cache_file_name); }
+
+    static Listing list(const QString &applications_dir)
+    {
+        Listing listing;
+        if (!QFile::exists(applications_dir))
+            return listing;
+
+        listing.directories << applications_dir;
+        QDirIterator it(applications_dir,
+                        QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot,
+                        QDirIterator::Subdirectories | QDirIterator::FollowSymlinks);
+        while (it.hasNext())
+        {
+            const auto fi = it.nextFileInfo();
+            if (fi.isDir())
+                listing.directories << fi.filePath();
+            else if (fi.suffix() == u"desktop"_s)
+            {
+                // The id is the path relative to the applications dir with '/' replaced by '-'
+                auto id = QDir(applications_dir).relativeFilePath(fi.filePath());
+                id.replace(u'/', u'-');
+                listing.files.emplace_back(::move(id), fi.filePath());
+            }
+        }
+        return listing;
+    }
+
+    ScanResult scan(const bool &abort) const
+    {
+        ScanResult result;
+
+        const auto listings = QtConcurrent::blockingMapped<vector<Listing>>(
+            &backgroundThreadPool(),
+            QStandardPaths::standardLocations(QStandardPaths::ApplicationsLocation),
+            &Private::list);
+
+        if (abort)
+            return {};
+
+        // Directories are ordered by precedence, the first file of an id wins
+        map<QString, QString> effective;  // Id to path
+        for (const auto &listing : listings)
+        {
+            result.directories << listing.directories;
+            for (const auto &[id, path] : listing.files)
+                effective.emplace(id, path);
+        }
+
+        const vector<pair<QString, QString>> candidates(effective.begin(), effective.end());
+        auto parsed = QtConcurrent::blockingMapped<vector<pair<QString, CachedFile>>>(
+            &backgroundThreadPool(),
+            candidates,
+            [this, &abort](const pair<QString, QString> &candidate) -> pair<QString, CachedFile> {
+                const auto &[id, path] = candidate;
+                const QFileInfo fi(path);
+                CachedFile file{id, fi.lastModified().toMSecsSinceEpoch(), fi.size(), {}, {}};
+
+                if (abort)
+                    return {};
+
+                // Files are written by the main thread only when no scan is running
+                if (const auto it = files.find(path);
+                    it != files.end() && it->second.id == id
+                    && it->second.mtime == file.mtime && it->second.size == file.size)
+                    return {path, it->second};
+
+                try {
+                    // Keep the parsed contents only, do not keep thousands of files mapped
+                    file.contents = DesktopEntryParser(path).toBytes();
+                    file.parser = make_shared<DesktopEntryParser>(
+                        DesktopEntryParser::fromBytes(file.contents));
+                } catch (const exception &e) {
+                    WARN << e.what();
+                }
+                return {path, ::move(file)};
+            });
+
+        if (abort)
+            return {};
+
+        bool dirty = parsed.size() != files.size();
+        for (auto &[path, file] : parsed)
+            if (file.parser)
+            {
+                if (const auto it = files.find(path); it == files.end() || it->second.parser != file.parser)
+                    dirty = true;
+                result.files.emplace(::move(path), ::move(file));
+            }
+
+        if (dirty)
+            save(result.files);
+
+        return result;
+    }
+
+    void onScanFinished(ScanResult result)
+    {
+        ChangeSet changes;
+        map<QString, Entry> new_entries;
+        for (const auto &[path, file] : result.files)
+        {
+            Entry entry{file.id, path, file.parser};
+            if (const auto it = entries.find(file.id); it == entries.end())
+                changes.added.emplace_back(entry);
+            else if (it->second.parser != file.parser)
+                changes.modified.emplace_back(entry);
+            new_entries.emplace(file.id, ::move(entry));
+        }
+
+        for (const auto &[id, entry] : entries)
+            if (!new_entries.contains(id))
+                changes.removed.emplace_back(id);
+
+        files = ::move(result.files);
+        entries = ::move(new_entries);
+
+        // Installed packages may add directories
+        if (const auto watched = watcher.directories(); !watched.isEmpty())
+            watcher.removePaths(watched);
+        if (!result.directories.isEmpty())
+            watcher.addPaths(result.directories);
+
+        if (changes.added.empty() && changes.modified.empty() && changes.removed.empty())
+            return;
+
+        DEBG << u"Desktop entries: %1 added, %2 modified, %3 removed"_s
+                    .arg(changes.added.size()).arg(changes.modified.size()).arg(changes.removed.size());
+
+        emit q->changed(changes);
+    }
+
+    void load()
+    {
+        QFile file(cacheFilePath());
+        if (!file.open(QIODevice::ReadOnly))
+            return;
+
+        QDataStream s(&file);
+        quint32 magic, version, count;
+        QString locale;
+        s >> magic >> version >> locale >> count;
+
+        // Localizations of other locales are not cached
+        if (magic != cache_magic || version != cache_version || locale != QLocale().name())
+            return;
+
+        for (quint32 i = 0; i < count && s.status() == QDataStream::Ok; ++i)
+        {
+            QString path;
+            CachedFile cached;
+            s >> path >> cached.id >> cached.mtime >> cached.size >> cached.contents;
+            cached.parser = make_shared<DesktopEntryParser>(
+                DesktopEntryParser::fromBytes(cached.contents));
+            files.emplace(::move(path), ::move(cached));
+        }
+
+        if (s.status() != QDataStream::Ok)
+        {
+            WARN << "Desktop entry cache is corrupt.";
+            files.clear();
+            return;
+        }
+
+        for (const auto &[path, cached] : files)
+            entries.emplace(cached.id, Entry{cached.id, path, cached.parser});
+    }
+
+    static void save(const map<QString, CachedFile> &files)
+    {
+        QSaveFile file(cacheFilePath());
+        if (!file.open(QIODevice::WriteOnly))
+        {
+            WARN << u"Failed to write desktop entry cache: %1"_s.arg(file.errorString());
+            return;
+        }
+
+        QDataStream s(&file);
+        s << cache_magic << cache_version << QLocale().name() << (quint32)files.size();
+        for (const auto &[path, cached] : files)
+            s << path << cached.id << cached.mtime << cached.size << cached.contents;
+
+        if (!file.commit())
+            WARN << u"Failed to write desktop entry cache: %1"_s.arg(file.errorString());
+    }
+};
+
+DesktopEntryScanner::DesktopEntryScanner() : d(make_unique<Private>())
+{
+    d->q = this;
+    d->load();
+
+    d->executor.parallel = [this](const bool &abort){ return d->scan(abort); };
+    d->executor.finish = [this]{ d->onScanFinished(d->executor.takeResult()); };
+
+    d->rescan_timer.setSingleShot(true);
+    d->rescan_timer.setInterval(rescan_delay);
+    connect(&d->rescan_timer, &QTimer::timeout, this, &DesktopEntryScanner::rescan);
+    connect(&d->watcher, &QFileSystemWatcher::directoryChanged,
+            &d->rescan_timer, qOverload<>(&QTimer::start));
+
+    rescan();
+}
+
+DesktopEntryScanner::~DesktopEntryScanner() = default;
+
+DesktopEntryScanner &DesktopEntryScanner::instance()
+{
+    // Not a function local static, those are destroyed after the application
+    if (!scanner)
+        scanner = new DesktopEntryScanner;
+    return *scanner;
+}
+
+void DesktopEntryScanner::shutdown()
+{
+    delete scanner;
+    scanner = nullptr;
+}
+
+const map<QString, DesktopEntryScanner::Entry> &DesktopEntryScanner::entries() const
+{ return d->entries; }
+
+void DesktopEntryScanner::rescan() { d->executor.run(); }
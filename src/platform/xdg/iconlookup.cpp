@@ -1,25 +1,33 @@
-// Copyright (c) 2023-2024 Manuel Schneider
+// Copyright (c) 2023-2026 Manuel Schneider
 
+#include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
 #include <QFileInfo>
 #include <QIcon>
 #include <QStandardPaths>
 #include <QString>
-#include "themefileparser.h"
 #include "iconlookup.h"
 using namespace std;
 
 namespace  {
-    QStringList icon_extensions = {"png", "svg", "xpm"};
+    // Requested sizes are rounded up to these to share cache entries
+    const int size_buckets[] = {16, 22, 24, 32, 48, 64, 96, 128, 256, 512};
 }
 
-QString XDG::IconLookup::iconPath(QString iconName, QSize , QString themeName)  // FIXME unused qsize
+static int sizeBucket(const QSize &size)
 {
-    return instance()->themeIconPath(iconName, themeName);
+    if (!size.isValid())
+        return 0;  // Largest
+
+    const int s = max(size.width(), size.height());
+    for (int bucket : size_buckets)
+        if (s <= bucket)
+            return bucket;
+    return s;
 }
 
-XDG::IconLookup::IconLookup()
+static QStringList defaultIconDirs()
 {
     /*
      * Icons and themes are looked for in a set of directories. By default,
@@ -27,31 +35,85 @@ XDG::IconLookup::IconLookup()
      * $XDG_DATA_DIRS/icons and in /usr/share/pixmaps (in that order).
      */
 
+    QStringList iconDirs;
+
     QString path = QDir::home().filePath(".icons");
     if (QFile::exists(path))
-        iconDirs_.append(path);
+        iconDirs.append(path);
 
     for (const QString &basedir : QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation))
         if (QFile::exists(path = QDir(basedir).filePath("icons")))
-            iconDirs_.append(path);
+            iconDirs.append(path);
 
     // Not in spec, but for tolerance
     if (path = QStringLiteral("/usr/local/share/pixmaps"); QFile::exists(path))
-        iconDirs_.append(path);
+        iconDirs.append(path);
 
     if (path = QStringLiteral("/usr/share/pixmaps"); QFile::exists(path))
-        iconDirs_.append(path);
+        iconDirs.append(path);
+
+    return iconDirs;
+}
+
+QString XDG::IconLookup::iconPath(QString iconName, QSize size, QString themeName)
+{
+    return instance().path(iconName, size, themeName);
+}
+
+QString XDG::IconLookup::path(QString iconName, QSize size, QString themeName)
+{
+    return themeIconPath(iconName, sizeBucket(size), themeName);
+}
+
+XDG::IconLookup::IconLookup() : IconLookup(defaultIconDirs()) {}
+
+XDG::IconLookup::IconLookup(const QStringList &iconDirs) : iconDirs_(iconDirs)
+{
+    unthemedIcons_ = indexUnthemedIcons();
+
+    // Lookups may happen in any thread, the watcher needs an event loop
+    if (auto *app = QCoreApplication::instance())
+        watcher_.moveToThread(app->thread());
+    QObject::connect(&watcher_, &QFileSystemWatcher::directoryChanged,
+                     &watcher_, [this]{ onChanged(); });
+    QObject::connect(&watcher_, &QFileSystemWatcher::fileChanged,
+                     &watcher_, [this]{ onChanged(); });
+    QMetaObject::invokeMethod(&watcher_, [this]{ watcher_.addPaths(iconDirs_); });
 }
 
-XDG::IconLookup *XDG::IconLookup::instance()
+XDG::IconLookup &XDG::IconLookup::instance()
 {
-    static IconLookup *instance_ = nullptr;
-    if (!instance_)
-        instance_ = new IconLookup();
-    return instance_;
+    static IconLookup instance;
+    return instance;
 }
 
-QString XDG::IconLookup::themeIconPath(QString iconName, QString themeName)
+unordered_map<QString, QString> XDG::IconLookup::indexUnthemedIcons() const
+{
+    // First dir and extension wins
+    unordered_map<QString, QString> icons;
+    const auto &extensions = ThemeIndex::extensions();
+    for (const QString &iconDir : iconDirs_)
+        for (const QString &ext : extensions)
+            for (const QString &file : QDir(iconDir).entryList({QString("*.%1").arg(ext)}, QDir::Files))
+                icons.emplace(file.chopped(ext.size() + 1), QString("%1/%2").arg(iconDir, file));
+    return icons;
+}
+
+void XDG::IconLookup::onChanged()
+{
+    auto unthemedIcons = indexUnthemedIcons();
+
+    lock_guard lock(mutex_);
+
+    // Icons may have been installed. Forget misses and reload the indexes, unchanged themes
+    // load quickly from the disk cache.
+    ++generation_;
+    erase_if(iconCache_, [](const auto &entry){ return entry.second.isNull(); });
+    themes_.clear();
+    unthemedIcons_ = move(unthemedIcons);
+}
+
+QString XDG::IconLookup::themeIconPath(QString iconName, int size, QString themeName)
 {
     if (iconName.isEmpty())
         return {};
@@ -68,38 +130,53 @@ QString XDG::IconLookup::themeIconPath(QString iconName, QString themeName)
     }
 
     // check if it has an extension and strip it
-    for (const QString &ext: icon_extensions)
+    for (const QString &ext: ThemeIndex::extensions())
         if (iconName.endsWith(QString(".").append(ext)))
             iconName.chop(4);
 
     // Check cache
-    try {
-        return iconCache_.at(iconName);
-    } catch (const out_of_range &) {}
+    const auto key = make_tuple(iconName, themeName, size);
+    uint generation;
+    {
+        lock_guard lock(mutex_);
+        if (const auto it = iconCache_.find(key); it != iconCache_.end())
+            return it->second;
+        generation = generation_;
+    }
+
+    const auto cache = [&](const QString &iconPath) {
+        lock_guard lock(mutex_);
+        if (generation == generation_)
+            iconCache_.emplace(key, iconPath);
+        return iconPath;
+    };
 
     QStringList checkedThemes;
     QString iconPath;
 
     // Lookup themefile
-    if (!(iconPath = doRecursiveIconLookup(iconName, themeName, &checkedThemes)).isNull())
-        return iconCache_.emplace(iconName, iconPath).first->second;
+    if (!(iconPath = doRecursiveIconLookup(iconName, size, themeName, &checkedThemes, generation)).isNull())
+        return cache(iconPath);
 
     // Lookup in hicolor
     if (!checkedThemes.contains("hicolor"))
-        if (!(iconPath = doRecursiveIconLookup(iconName, "hicolor", &checkedThemes)).isNull())
-            return iconCache_.emplace(iconName, iconPath).first->second;
+        if (!(iconPath = doRecursiveIconLookup(iconName, size, "hicolor", &checkedThemes, generation)).isNull())
+            return cache(iconPath);
 
     // Now search unsorted
-    for (const QString &iconDir: iconDirs_)
-        for (const QString &ext: icon_extensions)
-            if (QFile(iconPath = QString("%1/%2.%3").arg(iconDir, iconName, ext)).exists())
-                return iconCache_.emplace(iconName, iconPath).first->second;
+    {
+        lock_guard lock(mutex_);
+        if (const auto it = unthemedIcons_.find(iconName); it != unthemedIcons_.end())
+            iconPath = it->second;
+    }
 
-    // Nothing found, save though to avoid repeated expensive lookups
-    return iconCache_.emplace(iconName, QString()).first->second;
+    // Misses are cached too to avoid repeated lookups. They expire on changes.
+    return cache(iconPath);
 }
 
-QString XDG::IconLookup::doRecursiveIconLookup(const QString &iconName, const QString &themeName, QStringList *checked)
+QString XDG::IconLookup::doRecursiveIconLookup(const QString &iconName, int size,
+                                               const QString &themeName, QStringList *checked,
+                                               uint generation)
 {
     // Exlude multiple scans
     if (checked->contains(themeName))
@@ -107,19 +184,17 @@ QString XDG::IconLookup::doRecursiveIconLookup(const QString &iconName, const QS
     checked->append(themeName);
 
     // Check if theme exists
-    QString themeFile = lookupThemeFile(themeName);
-    if (themeFile.isNull())
+    const auto index = themeIndex(themeName, generation);
+    if (!index->isValid())
         return {};
 
     // Check if icon exists
-    QString iconPath;
-    iconPath = doIconLookup(iconName, themeFile);
-    if (!iconPath.isNull())
-        return iconPath;
+    if (const auto *entry = index->bestEntry(iconName, size))
+        return index->path(iconName, *entry);
 
     // Check its parents too
-    for (const QString &parent: ThemeFileParser(themeFile).inherits()) {
-        iconPath = doRecursiveIconLookup(iconName, parent, checked);
+    for (const QString &parent: index->inherits()) {
+        QString iconPath = doRecursiveIconLookup(iconName, size, parent, checked, generation);
         if (!iconPath.isNull())
             return iconPath;
     }
@@ -127,47 +202,36 @@ QString XDG::IconLookup::doRecursiveIconLookup(const QString &iconName, const QS
     return {};
 }
 
-QString XDG::IconLookup::doIconLookup(const QString &iconName, const QString &themeFile)
+shared_ptr<const XDG::ThemeIndex> XDG::IconLookup::themeIndex(const QString &themeName,
+                                                              uint generation)
 {
-    ThemeFileParser themeFileParser(themeFile);
-    QDir themeDir = QFileInfo(themeFile).dir();
-    QString themeName = themeDir.dirName();
-
-    // Get the sizes of the dirs
-    vector<pair<QString, int>> dirsAndSizes;
-    for (const QString &subdir: themeFileParser.directories())
-        dirsAndSizes.push_back(make_pair(subdir, themeFileParser.size(subdir)));
-
-    // Sort them by size
-    sort(dirsAndSizes.begin(), dirsAndSizes.end(),
-         [](pair<QString, int> a, pair<QString, int> b) {
-             return a.second > b.second;
-         });
-
-    // Well now search for a file beginning with the greatest
-    QString filename;
-    QFile file;
-    for (const auto &dirAndSize: dirsAndSizes) {
-        for (const QString &iconDir: iconDirs_) {
-            for (const QString &ext: icon_extensions) {
-                filename = QString("%1/%2/%3/%4.%5").arg(iconDir, themeName, dirAndSize.first, iconName, ext);
-                if (file.exists(filename)) {
-                    return filename;
-                }
-            }
-        }
+    {
+        lock_guard lock(mutex_);
+        if (const auto it = themes_.find(themeName); it != themes_.end())
+            return it->second;
     }
 
-    return {};
-}
-
-QString XDG::IconLookup::lookupThemeFile(const QString &themeName)
-{
-    // Lookup themefile
-    for (const QString &iconDir: iconDirs_) {
-        QString indexFile = QString("%1/%2/index.theme").arg(iconDir, themeName);
-        if (QFile(indexFile).exists())
-            return indexFile;
+    // Scans take long, do not block other lookups. Concurrent first lookups may index twice.
+    auto index = make_shared<const ThemeIndex>(themeName, iconDirs_);
+
+    // Watch the theme roots and index files only. Icon caches like icon-theme.cache in the
+    // root are updated on installations. Watching every directory exhausts inotify watches.
+    QStringList paths;
+    if (index->isValid())
+    {
+        for (const auto &iconDir : iconDirs_)
+            if (const auto root = QString("%1/%2").arg(iconDir, themeName); QFile::exists(root))
+                paths << root;
+        paths << index->indexFile();
     }
-    return {};
+
+    lock_guard lock(mutex_);
+
+    if (generation != generation_)
+        return index;  // Possibly outdated, use but do not keep
+
+    const auto [it, inserted] = themes_.emplace(themeName, index);
+    if (inserted && !paths.isEmpty())
+        QMetaObject::invokeMethod(&watcher_, [this, paths]{ watcher_.addPaths(paths); });
+    return it->second;
 }
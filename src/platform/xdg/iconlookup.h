@@ -1,12 +1,23 @@
-// Copyright (C) 2014-2024 Manuel Schneider
+// Copyright (C) 2014-2026 Manuel Schneider
 
 #pragma once
+#include "themeindex.h"
+#include <QFileSystemWatcher>
 #include <QSize>
 #include <QStringList>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
 
 namespace XDG {
 
+///
+/// XDG icon lookup.
+///
+/// This class is thread-safe.
+///
 class IconLookup
 {
 public:
@@ -14,23 +25,37 @@ public:
     /**
      * @brief iconPath Does XDG icon lookup for the given icon name
      * @param iconName The icon name to lookup
+     * @param size The size the icon is requested for, the largest icon is returned if invalid
      * @param themeName The theme to use, use current theme if empty
      * @return If an icon was found the path to the icon, else an empty string
      */
     static QString iconPath(QString iconName, QSize size = QSize(), QString themeName = QString());
 
-private:
+    /// Constructs a lookup in _iconDirs_. Use \ref iconPath for the lookup in the XDG icon dirs.
+    IconLookup(const QStringList &iconDirs);
 
-    IconLookup();
-    static IconLookup *instance();
+    /// Does the lookup of \ref iconPath in the icon dirs of this instance.
+    QString path(QString iconName, QSize size = QSize(), QString themeName = QString());
 
-    QString themeIconPath(QString iconName, QString themeName = QString());
-    QString doRecursiveIconLookup(const QString &iconName, const QString &theme, QStringList *checked);
-    QString doIconLookup(const QString &iconName, const QString &themeFile);
-    QString lookupThemeFile(const QString &themeName);
+private:
 
-    QStringList iconDirs_;
-    std::map<QString, QString> iconCache_;
+    IconLookup();
+    static IconLookup &instance();
+
+    QString themeIconPath(QString iconName, int size, QString themeName);
+    QString doRecursiveIconLookup(const QString &iconName, int size, const QString &theme,
+                                  QStringList *checked, uint generation);
+    std::shared_ptr<const ThemeIndex> themeIndex(const QString &themeName, uint generation);
+    std::unordered_map<QString, QString> indexUnthemedIcons() const;
+    void onChanged();
+
+    std::mutex mutex_;  // Not held during disk I/O
+    const QStringList iconDirs_;
+    uint generation_ = 0;  // Incremented on changes, results of older lookups are not cached
+    std::map<std::tuple<QString, QString, int>, QString> iconCache_;  // (name, theme, size bucket)
+    std::map<QString, std::shared_ptr<const ThemeIndex>> themes_;
+    std::unordered_map<QString, QString> unthemedIcons_;  // Files in the icon dirs
+    QFileSystemWatcher watcher_;
 };
 
 }
@@ -1,9 +1,12 @@
 // Copyright (c) 2023-2024 Manuel Schneider
 
+#include "desktopentryscanner.h"
 #include "platform.h"
 
 void platform::initPlatform(){}
 
+void platform::deinitPlatform() { albert::detail::DesktopEntryScanner::shutdown(); }
+
 void platform::initNativeWindow(unsigned long long){}
 
 
@@ -0,0 +1,321 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "logging.h"
+#include "themefileparser.h"
+#include "themeindex.h"
+#include "trace.h"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <albert/app.h>
+#include <algorithm>
+#include <limits>
+#include <ranges>
+using namespace Qt::StringLiterals;
+using namespace std;
+using namespace XDG;
+
+namespace
+{
+static const quint32 cache_magic = 0x616c6274;  // "albt"
+static const quint32 cache_version = 1;
+}
+
+static QDataStream &operator<<(QDataStream &s, const ThemeIndex::Directory &d)
+{ return s << d.path << d.size << d.min_size << d.max_size << d.threshold << (qint8)d.type; }
+
+static QDataStream &operator>>(QDataStream &s, ThemeIndex::Directory &d)
+{
+    qint8 type;
+    s >> d.path >> d.size >> d.min_size >> d.max_size >> d.threshold >> type;
+    d.type = static_cast<ThemeIndex::Directory::Type>(type);
+    return s;
+}
+
+ThemeIndex::ThemeIndex(const QString &theme_name, const QStringList &icon_dirs)
+    : name_(theme_name)
+    , icon_dirs_(icon_dirs)
+{
+    if (load())
+        return;
+
+    scan();
+
+    if (isValid())
+        save();
+}
+
+bool ThemeIndex::isValid() const { return !index_file_.isNull(); }
+
+const QString &ThemeIndex::name() const { return name_; }
+
+const QString &ThemeIndex::indexFile() const { return index_file_; }
+
+const QStringList &ThemeIndex::inherits() const { return inherits_; }
+
+const vector<ThemeIndex::Directory> &ThemeIndex::directories() const { return directories_; }
+
+const vector<ThemeIndex::Entry> *ThemeIndex::entries(const QString &icon_name) const
+{
+    if (const auto it = icons_.find(icon_name); it != icons_.end())
+        return &it->second;
+    return nullptr;
+}
+
+const ThemeIndex::Entry *ThemeIndex::bestEntry(const QString &icon_name, int size) const
+{
+    const auto *entries = this->entries(icon_name);
+    if (!entries)
+        return nullptr;
+
+    if (size <= 0)
+        return &entries->front();
+
+    // See DirectoryMatchesSize and DirectorySizeDistance of the spec
+    const auto distance = [size](const Directory &d) {
+        switch (d.type) {
+        case Directory::Fixed:
+            return abs(d.size - size);
+        case Directory::Scalable:
+            return size < d.min_size ? d.min_size - size
+                   : size > d.max_size ? size - d.max_size
+                                       : 0;
+        case Directory::Threshold:
+            return size < d.size - d.threshold ? d.size - d.threshold - size
+                   : size > d.size + d.threshold ? size - d.size - d.threshold
+                                                 : 0;
+        }
+        return numeric_limits<int>::max();
+    };
+
+    // First wins on ties, i.e. larger directories and preferred extensions
+    return &*ranges::min_element(*entries, {}, [&](const Entry &e) {
+        return distance(directories_[e.directory]);
+    });
+}
+
+QString ThemeIndex::path(const QString &icon_name, const Entry &entry) const
+{
+    return u"%1/%2/%3/%4.%5"_s.arg(icon_dirs_[entry.base],
+                                   name_,
+                                   directories_[entry.directory].path,
+                                   icon_name,
+                                   extensions()[entry.extension]);
+}
+
+const QStringList &ThemeIndex::extensions()
+{
+    static const QStringList extensions{u"png"_s, u"svg"_s, u"xpm"_s};
+    return extensions;
+}
+
+QString ThemeIndex::cacheFilePath() const
+{
+    return QDir(albert::app().cacheLocation()).filePath(u"icon-themes/%1.index"_s.arg(name_));
+}
+
+vector<pair<QString, qint64>> ThemeIndex::modificationTimes() const
+{
+    // Adding or removing files changes the modification time of their directory
+    vector<pair<QString, qint64>> mtimes;
+    const auto stat = [&](const QString &path) {
+        const QFileInfo fi(path);
+        mtimes.emplace_back(path, fi.exists() ? fi.lastModified().toMSecsSinceEpoch() : -1);
+    };
+
+    stat(index_file_);
+    for (const auto &icon_dir : icon_dirs_)
+    {
+        const auto theme_dir = u"%1/%2"_s.arg(icon_dir, name_);
+        stat(theme_dir);
+        for (const auto &directory : directories_)
+            stat(u"%1/%2"_s.arg(theme_dir, directory.path));
+    }
+    return mtimes;
+}
+
+void ThemeIndex::scan()
+{
+    Trace::Span span("icon", "indexTheme", name_);
+
+    for (const auto &icon_dir : icon_dirs_)
+        if (const auto path = u"%1/%2/index.theme"_s.arg(icon_dir, name_); QFile::exists(path))
+        {
+            index_file_ = path;
+            break;
+        }
+
+    if (index_file_.isNull())
+        return;
+
+    ThemeFileParser parser(index_file_);
+    inherits_ = parser.inherits();
+
+    for (const auto &subdir : parser.directories())
+    {
+        const auto type = parser.type(subdir);
+        directories_.emplace_back(subdir,
+                                  parser.size(subdir),
+                                  parser.minSize(subdir),
+                                  parser.maxSize(subdir),
+                                  parser.threshold(subdir),
+                                  type == u"Fixed"_s      ? Directory::Fixed
+                                  : type == u"Scalable"_s ? Directory::Scalable
+                                                          : Directory::Threshold);
+    }
+
+    // Largest first. Entries inherit this order.
+    ranges::stable_sort(directories_, greater{}, &Directory::size);
+
+    vector<pair<QString, quint8>> files;
+    for (quint16 d = 0; d < directories_.size(); ++d)
+        for (quint8 b = 0; b < icon_dirs_.size(); ++b)
+        {
+            const QDir dir(u"%1/%2/%3"_s.arg(icon_dirs_[b], name_, directories_[d].path));
+
+            files.clear();
+            for (const auto &file_name : dir.entryList(QDir::Files))
+            {
+                const auto dot = file_name.lastIndexOf(u'.');
+                if (const auto e = extensions().indexOf(file_name.mid(dot + 1)); dot > 0 && e >= 0)
+                    files.emplace_back(file_name.left(dot), (quint8)e);
+            }
+
+            ranges::stable_sort(files, less{}, &decltype(files)::value_type::second);
+
+            for (auto &[icon_name, e] : files)
+                icons_[icon_name].emplace_back(d, b, e);
+        }
+
+    mtimes_ = modificationTimes();
+
+    DEBG << u"Indexed %1 icons of theme '%2'"_s.arg(icons_.size()).arg(name_);
+}
+
+bool ThemeIndex::load()
+{
+    QFile file(cacheFilePath());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream s(&file);
+    quint32 magic, version;
+    QString name;
+    QStringList icon_dirs;
+    s >> magic >> version;
+    if (magic != cache_magic || version != cache_version)
+        return false;
+
+    s >> name >> icon_dirs;
+    if (name != name_ || icon_dirs != icon_dirs_)
+        return false;
+
+    const auto reset = [this]{
+        index_file_.clear();
+        inherits_.clear();
+        directories_.clear();
+        icons_.clear();
+        mtimes_.clear();
+        return false;
+    };
+
+    const auto fail = [&]{
+        WARN << u"Discarding corrupt icon theme index '%1'"_s.arg(file.fileName());
+        return reset();
+    };
+
+    // The file is untrusted. Validate counts before allocating and indices before storing.
+    // Every serialized element takes at least one byte, bounding any count by the file size.
+    quint32 directory_count, icon_count, entry_count, mtime_count;
+
+    s >> index_file_ >> inherits_ >> directory_count;
+    if (s.status() != QDataStream::Ok
+        || directory_count > numeric_limits<decltype(Entry::directory)>::max() + 1u
+        || directory_count > file.size())
+        return fail();
+
+    directories_.resize(directory_count);
+    for (auto &directory : directories_)
+        s >> directory;
+
+    s >> icon_count;
+    if (s.status() != QDataStream::Ok || icon_count > file.size())
+        return fail();
+
+    // Each directory of each icon dir has at most one file per extension
+    const auto max_entry_count = directory_count * icon_dirs_.size() * extensions().size();
+
+    icons_.reserve(icon_count);
+    for (quint32 i = 0; i < icon_count; ++i)
+    {
+        QString icon_name;
+        s >> icon_name >> entry_count;
+        if (s.status() != QDataStream::Ok || entry_count > max_entry_count)
+            return fail();
+
+        auto &entries = icons_[icon_name];
+        entries.resize(entry_count);
+        for (auto &entry : entries)
+        {
+            s >> entry.directory >> entry.base >> entry.extension;
+            if (entry.directory >= directories_.size()
+                || entry.base >= icon_dirs_.size()
+                || entry.extension >= extensions().size())
+                return fail();
+        }
+    }
+
+    const auto mtimes = modificationTimes();
+    s >> mtime_count;
+    if (s.status() != QDataStream::Ok || mtime_count != mtimes.size())
+        return fail();
+
+    mtimes_.resize(mtime_count);
+    for (auto &[path, mtime] : mtimes_)
+        s >> path >> mtime;
+
+    if (s.status() != QDataStream::Ok)
+        return fail();
+
+    if (mtimes_ != mtimes)  // Outdated
+        return reset();
+
+    return true;
+}
+
+void ThemeIndex::save() const
+{
+    const auto path = cacheFilePath();
+    QDir().mkpath(QFileInfo(path).path());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        WARN << u"Failed to write icon theme index '%1': %2"_s.arg(path, file.errorString());
+        return;
+    }
+
+    QDataStream s(&file);
+    s << cache_magic << cache_version << name_ << icon_dirs_ << index_file_ << inherits_;
+
+    s << (quint32)directories_.size();
+    for (const auto &directory : directories_)
+        s << directory;
+
+    s << (quint32)icons_.size();
+    for (const auto &[icon_name, entries] : icons_)
+    {
+        s << icon_name << (quint32)entries.size();
+        for (const auto &entry : entries)
+            s << entry.directory << entry.base << entry.extension;
+    }
+
+    s << (quint32)mtimes_.size();
+    for (const auto &[dir_path, mtime] : mtimes_)
+        s << dir_path << mtime;
+
+    if (!file.commit())
+        WARN << u"Failed to write icon theme index '%1': %2"_s.arg(path, file.errorString());
+}
@@ -0,0 +1,91 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace XDG {
+
+///
+/// Index of the icon files of an XDG icon theme.
+///
+/// Scans all directories of the theme once and maps icon names to their files. The index is
+/// cached on disk along with the modification times of the scanned directories.
+///
+class ThemeIndex
+{
+public:
+
+    struct Directory
+    {
+        enum Type : qint8 { Fixed, Scalable, Threshold };
+
+        QString path;  // Relative to the theme directories
+        int size;
+        int min_size;
+        int max_size;
+        int threshold;
+        Type type;
+    };
+
+    struct Entry
+    {
+        quint16 directory;  // Index in directories()
+        quint8 base;  // Index in the icon directories
+        quint8 extension;  // Index in extensions()
+    };
+
+    /// Loads the index of _theme_name_ from the disk cache or scans the theme in _icon_dirs_.
+    ThemeIndex(const QString &theme_name, const QStringList &icon_dirs);
+
+    /// Returns `false` if the theme does not exist.
+    bool isValid() const;
+
+    const QString &name() const;
+
+    /// Returns the path of the index.theme file.
+    const QString &indexFile() const;
+
+    const QStringList &inherits() const;
+
+    const std::vector<Directory> &directories() const;
+
+    /// Returns the files of _icon_name_, largest directories first, or nullptr if there are none.
+    const std::vector<Entry> *entries(const QString &icon_name) const;
+
+    ///
+    /// Returns the file of _icon_name_ best fitting _size_, or nullptr if there is none.
+    ///
+    /// Follows the directory matching rules of the icon theme specification. If _size_ is zero
+    /// the file in the largest directory is returned.
+    ///
+    const Entry *bestEntry(const QString &icon_name, int size) const;
+
+    /// Returns the path of the file _entry_ of _icon_name_.
+    QString path(const QString &icon_name, const Entry &entry) const;
+
+    /// Returns the supported file extensions in the order of preference.
+    static const QStringList &extensions();
+
+private:
+
+    QString cacheFilePath() const;
+    bool load();
+    void save() const;
+    void scan();
+    std::vector<std::pair<QString, qint64>> modificationTimes() const;
+
+    const QString name_;
+    const QStringList icon_dirs_;
+    QString index_file_;
+    QStringList inherits_;
+    std::vector<Directory> directories_;
+    std::unordered_map<QString, std::vector<Entry>> icons_;
+    std::vector<std::pair<QString, qint64>> mtimes_;  // Of the scanned directories
+
+};
+
+}
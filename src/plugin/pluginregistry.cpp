@@ -9,6 +9,7 @@
 #include "pluginmetadata.h"
 #include "pluginprovider.h"
 #include "pluginregistry.h"
+#include "startuptrace.h"
 #include "topologicalsort.hpp"
 #include <QCoreApplication>
 #include <QSettings>
@@ -21,10 +22,33 @@ using namespace albert;
 using namespace std::chrono;
 using namespace std;
 
+namespace
+{
+static const auto deferred_activation_delay = 60s;
+}
+
+// Plugins providing trigger handlers only are not needed before their trigger is used
+static bool isDeferrable(const Plugin &p)
+{
+    return !p.metadata.triggers.isEmpty()
+           && p.metadata.handler_kinds == QStringList{u"trigger"_s};
+}
+
 PluginRegistry::PluginRegistry(ExtensionRegistry &reg, bool autoload_enabled_plugins) :
     extension_registry_(reg),
     load_enabled_(autoload_enabled_plugins)
 {
+    // Load deferred plugins eventually, when the startup rush is over
+    deferred_activation_timer_.setSingleShot(true);
+    deferred_activation_timer_.setInterval(deferred_activation_delay);
+    connect(&deferred_activation_timer_, &QTimer::timeout, this, [this] {
+        if (!deferred_plugins_.empty())
+        {
+            DEBG << "Loading" << deferred_plugins_.size() << "deferred plugins";
+            load(deferred_plugins_);
+        }
+    });
+
     connect(&extension_registry_, &ExtensionRegistry::added,
             this, [this](Extension *e)
             { if (auto p = dynamic_cast<PluginProvider*>(e)) onRegistered(p); });
@@ -118,6 +142,32 @@ void PluginRegistry::setLoaded(const QString &id, bool loaded)
         unload({&plugins_.at(id)});
 }
 
+void PluginRegistry::activate(const QString &id)
+{
+    if (const auto it = plugins_.find(id);
+        it != plugins_.end() && deferred_plugins_.contains(&it->second))
+    {
+        DEBG << u"%1: Activated on first use."_s.arg(id);
+        load({&it->second});
+    }
+}
+
+void PluginRegistry::defer(const Plugin *p)
+{
+    if (deferred_plugins_.insert(p).second)
+    {
+        DEBG << u"%1: Loading deferred until first use."_s.arg(p->id);
+        emit pluginDeferralChanged(p->id, true);
+        deferred_activation_timer_.start();
+    }
+}
+
+void PluginRegistry::undefer(const Plugin *p)
+{
+    if (deferred_plugins_.erase(p))
+        emit pluginDeferralChanged(p->id, false);
+}
+
 std::set<const Plugin *> PluginRegistry::dependencies(const Plugin *p) const
 {
     auto v = p->loader.metadata().plugin_dependencies
@@ -229,7 +279,20 @@ void PluginRegistry::onRegistered(PluginProvider *pp)
                  | views::filter([pp](auto p) { return &p->provider == pp
                                                        && p->metadata.load_type == User
                                                        && p->enabled; });
-        load({v.begin(), v.end()});  // ranges::to
+        const set<const Plugin*> enabled{v.begin(), v.end()};  // ranges::to
+
+        // Defer deferrable plugins unless other plugins depend on them
+        set<const Plugin*> eager;
+        for (auto p : enabled)
+            if (!isDeferrable(*p))
+                eager.insert(p);
+        eager = dependencyClosure(eager);
+
+        for (auto p : enabled)
+            if (!eager.contains(p))
+                defer(p);
+
+        load(eager);
     }
 }
 
@@ -255,7 +318,10 @@ void PluginRegistry::load(set<const Plugin*> plugins)
     // Make dependency graph
     map<const Plugin*, set<const Plugin*>> graph;
     for (auto p : dependencyClosure(plugins))
+    {
+        undefer(p);
         graph.emplace(p, dependencies(p));
+    }
 
     // Remove loaded plugins from graph
     erase_if(graph, [](auto &p){ return p.first->state == Loaded; });
@@ -265,22 +331,49 @@ void PluginRegistry::load(set<const Plugin*> plugins)
     if (graph.empty())
         return;
 
+    // Prioritize plugins by the historical load duration of the longest chain of dependees
+    {
+        auto s = app().state();
+        const auto topo = topologicalSort(graph);  // Dependencies first
+        for (const Plugin *p : topo.sorted | views::reverse)
+        {
+            long dependee_path = 0;
+            for (const auto &[q, deps] : graph)
+                if (deps.contains(p))
+                    dependee_path = max(dependee_path, critical_path_[q]);
+            critical_path_[p] = s->value(u"%1/load_duration"_s.arg(p->id), 0).toLongLong()
+                                + dependee_path;
+        }
+    }
+
     loading_graph_.merge(::move(graph));
 
     // Load initial set without dependencies
+    vector<Plugin*> ready;
     for (auto it = begin(loading_graph_); it != end(loading_graph_);)
         if (it->second.empty())
         {
-            Plugin &p = *const_cast<Plugin*>(it->first);
-
-            loading_plugins_.insert(&p);
+            ready.push_back(const_cast<Plugin*>(it->first));
             it = loading_graph_.erase(it);
-
-            setPluginState(p, Loading);
-            p.loader.load();  // Async
         }
         else
             ++it;
+
+    launch(::move(ready));
+}
+
+void PluginRegistry::launch(vector<Plugin*> plugins)
+{
+    // Start the longest critical paths first. Libraries are loaded concurrently.
+    ranges::stable_sort(plugins, greater{}, [this](Plugin *p){ return critical_path_[p]; });
+
+    for (Plugin *p : plugins)
+    {
+        critical_path_.erase(p);
+        loading_plugins_.insert(p);
+        setPluginState(*p, Loading);
+        p->loader.load();  // Async
+    }
 }
 
 void PluginRegistry::unload(set<const Plugin*> plugins)
@@ -288,7 +381,10 @@ void PluginRegistry::unload(set<const Plugin*> plugins)
     // Make dependee graph
     map<const Plugin*, set<const Plugin*>> graph;
     for (auto p : dependeeClosure(plugins))
+    {
+        undefer(p);
         graph.emplace(p, dependees(p));
+    }
 
     // Remove unloaded plugins from graph
     erase_if(graph, [](auto &p){ return p.first->state == Unloaded; });
@@ -318,19 +414,16 @@ void PluginRegistry::onPluginLoaderFinished(Plugin &p, const QString &info)
     loading_plugins_.erase(&p);
 
     // remove dependecies in load graph
+    vector<Plugin*> ready;
     for (auto it = begin(loading_graph_); it != end(loading_graph_);)
         if (it->second.erase(&p) && it->second.empty())
         {
-            Plugin &p_ = *const_cast<Plugin*>(it->first);
-
-            loading_plugins_.insert(&p_);
+            ready.push_back(const_cast<Plugin*>(it->first));
             it = loading_graph_.erase(it);
-
-            setPluginState(p_, Loading);
-            p_.loader.load();  // may be async
         }
         else
             ++it;
+    launch(::move(ready));  // may be async
 
     if (auto *instance = p.loader.instance();
         !instance)
@@ -338,15 +431,20 @@ void PluginRegistry::onPluginLoaderFinished(Plugin &p, const QString &info)
     else
     {
         connect(instance, &PluginInstance::initialized,
-                this, [this, &p, tp=system_clock::now()] {
+                this, [this, &p, tp=StartupTrace::Clock::now()] {
+                    StartupTrace::record(p.id, StartupTrace::Phase::Initialization, tp);
                     DEBG << u"%1: Initialized in %2 ms"_s
                                 .arg(p.id)
-                                .arg(duration_cast<milliseconds>(system_clock::now() - tp).count());
+                                .arg(duration_cast<milliseconds>(StartupTrace::Clock::now() - tp).count());
 
                     try {
+                        const auto registration_tp = StartupTrace::Clock::now();
                         for (p.registered_extensions = p.loader.instance()->extensions();
                              auto *e : p.registered_extensions)
                             extension_registry_.registerExtension(e);
+                        StartupTrace::record(p.id, StartupTrace::Phase::Registration, registration_tp);
+                        app().state()->setValue(u"%1/load_duration"_s.arg(p.id),
+                                                (qlonglong)StartupTrace::duration(p.id).count());
                         setPluginState(p, Loaded);
                     }
                     catch (const exception &e) {
@@ -3,8 +3,10 @@
 #pragma once
 #include <QObject>
 #include <QString>
+#include <QTimer>
 #include <map>
 #include <set>
+#include <vector>
 namespace albert {
 class Extension;
 class ExtensionRegistry;
@@ -56,6 +58,9 @@ public:
     /// @throws std::out_of_range if `id` does not exist.
     void setLoaded(const QString &id, bool load);
 
+    /// Loads the plugin _id_ if its loading has been deferred until first use.
+    void activate(const QString &id);
+
     std::set<const Plugin*> dependencies(const Plugin*) const;
     std::set<const Plugin*> dependees(const Plugin*) const;
     std::set<const Plugin*> dependencyClosure(const std::set<const Plugin*>&) const;
@@ -65,6 +70,8 @@ private:
 
     void load(std::set<const Plugin*>);
     void unload(std::set<const Plugin *>);
+    void defer(const Plugin*);
+    void undefer(const Plugin*);
 
     void onRegistered(albert::PluginProvider*);
     void onDeregistered(albert::PluginProvider*);
@@ -76,6 +83,10 @@ private:
 
     std::set<const Plugin*> loading_plugins_;
     std::map<const Plugin*, std::set<const Plugin*>> loading_graph_;
+    std::map<const Plugin*, long> critical_path_;  // Historical load duration of dependee chains
+    std::set<const Plugin*> deferred_plugins_;  // Enabled, loaded on first use
+    QTimer deferred_activation_timer_;  // Idle activation of deferred plugins
+    void launch(std::vector<Plugin*>);
     void onPluginLoaderFinished(Plugin &p, const QString &info);
     void setPluginState(Plugin &plugin, Plugin::State state, const QString info = {});
 
@@ -84,5 +95,6 @@ signals:
     void pluginsChanged();
     void pluginEnabledChanged(const QString &id);
     void pluginStateChanged(const QString &id);
+    void pluginDeferralChanged(const QString &id, bool deferred);
 
 };
@@ -0,0 +1,85 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "startuptrace.h"
+#include "trace.h"
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <ranges>
+#include <vector>
+using namespace Qt::StringLiterals;
+using namespace std::chrono;
+using namespace std;
+
+namespace
+{
+struct Span
+{
+    StartupTrace::Clock::time_point begin;
+    StartupTrace::Clock::time_point end;
+};
+
+mutex trace_mutex;
+map<QString, map<StartupTrace::Phase, Span>> trace;  // By plugin id
+const auto origin = StartupTrace::Clock::now();  // Static initialization, roughly process start
+}
+
+static inline auto ms(StartupTrace::Clock::duration d) { return duration_cast<milliseconds>(d).count(); }
+
+static const char *phaseName(StartupTrace::Phase phase)
+{
+    switch (phase) {
+    case StartupTrace::Phase::Library: return "library";
+    case StartupTrace::Phase::Translations: return "translations";
+    case StartupTrace::Phase::Instantiation: return "instantiation";
+    case StartupTrace::Phase::Initialization: return "initialization";
+    case StartupTrace::Phase::Registration: return "registration";
+    }
+    return "";
+}
+
+void StartupTrace::record(const QString &id, Phase phase, Clock::time_point begin, Clock::time_point end)
+{
+    Trace::record("plugin", phaseName(phase), id, begin, end);
+    lock_guard lock(trace_mutex);
+    trace[id][phase] = {begin, end};
+}
+
+milliseconds StartupTrace::duration(const QString &id)
+{
+    lock_guard lock(trace_mutex);
+    Clock::duration total{};
+    if (const auto it = trace.find(id); it != trace.end())
+        for (const auto &span : it->second | views::values)
+            total += span.end - span.begin;
+    return duration_cast<milliseconds>(total);
+}
+
+QStringList StartupTrace::report()
+{
+    lock_guard lock(trace_mutex);
+
+    struct Line { Clock::time_point begin; QString text; };
+    vector<Line> lines;
+    for (const auto &[id, phases] : trace)
+    {
+        const auto begin = ranges::min(phases | views::values, {}, &Span::begin).begin;
+        const auto end = ranges::max(phases | views::values, {}, &Span::end).end;
+
+        QStringList durations;
+        for (const auto &[phase, span] : phases)
+            durations << u"%1 %2 ms"_s.arg(QLatin1StringView(phaseName(phase)))
+                                      .arg(ms(span.end - span.begin));
+
+        lines.emplace_back(begin, u"%1: +%2 ms … +%3 ms (%4)"_s
+                                      .arg(id).arg(ms(begin - origin)).arg(ms(end - origin))
+                                      .arg(durations.join(u", "_s)));
+    }
+
+    ranges::sort(lines, {}, &Line::begin);
+
+    QStringList report;
+    for (auto &line : lines)
+        report << ::move(line.text);
+    return report;
+}
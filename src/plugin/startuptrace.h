@@ -0,0 +1,36 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <chrono>
+
+///
+/// Records the durations of the phases of plugin loading.
+///
+/// This class is thread-safe.
+///
+class StartupTrace
+{
+public:
+
+    using Clock = std::chrono::steady_clock;
+
+    enum class Phase {
+        Library,  // dlopen
+        Translations,
+        Instantiation,
+        Initialization,
+        Registration
+    };
+
+    /// Records a _phase_ of loading plugin _id_. Replaces previous records of the phase.
+    static void record(const QString &id, Phase phase,
+                       Clock::time_point begin, Clock::time_point end = Clock::now());
+
+    /// Returns the total duration of the recorded phases of plugin _id_.
+    static std::chrono::milliseconds duration(const QString &id);
+
+    /// Returns a human readable report of the recorded phases, ordered by start time.
+    static QStringList report();
+};
@@ -15,6 +15,7 @@ class AsyncExecution final : public QueryExecution
     optional<AsyncItemGenerator::iterator> iterator;
     QCoro::Task<> fetch_task;
     bool active;
+    bool cancelled;
 
 public:
 
@@ -23,6 +24,7 @@ public:
         , generator(make_unique<AsyncItemGenerator>(::move(gen)))
         , iterator(nullopt)
         , active(false)
+        , cancelled(false)
     {
         fetchMore();
     }
@@ -38,12 +40,15 @@ public:
         // Deleting the generator, forces coroutine frame destruction and as such MAY BLOCK because
         // the coroutine implementation deliberately does so, e.g. to join a thread or such.
         // Since it must not block, deleting the generator on cancel is not an option.
+        // Instead stop fetching and drop the results of the pending fetch.
+        cancelled = true;
     }
 
     bool isActive() const override { return active; }
 
     bool canFetchMore() const override {
-        return context.isValid()
+        return !cancelled
+               && context.isValid()
                && (!iterator
                    // https://github.com/qcoro/qcoro/issues/294
                    || *iterator != const_cast<AsyncItemGenerator&>(*generator).end());
@@ -72,6 +77,9 @@ public:
             else
                 iterator = co_await generator->begin();
 
+            if (cancelled || !context.isValid())
+                co_return;
+
             if (*iterator != generator->end())
                 results.add(::move(**iterator));
 
@@ -0,0 +1,119 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "cancellationtoken.h"
+#include "logging.h"
+#include <atomic>
+#include <map>
+#include <mutex>
+using namespace albert;
+using namespace std;
+
+class CancellationToken::Private
+{
+public:
+    atomic_bool cancelled = false;
+    atomic<Clock::rep> deadline = Clock::time_point::max().time_since_epoch().count();
+    const shared_ptr<const Private> parent;
+    mutable mutex callbacks_mutex;
+    mutable map<uint, function<void()>> callbacks;
+    mutable uint next_callback_id = 0;
+    uint parent_callback_id = 0;
+
+    Private(shared_ptr<const Private> p = {}) : parent(::move(p)) {}
+
+    ~Private()
+    {
+        if (parent)
+        {
+            lock_guard lock(parent->callbacks_mutex);
+            parent->callbacks.erase(parent_callback_id);
+        }
+    }
+
+    bool isCancelled() const
+    {
+        if (cancelled.load(memory_order_relaxed))
+            return true;
+
+        // Avoid clock reads for tokens without deadline
+        if (const auto dl = deadline.load(memory_order_relaxed);
+            dl != Clock::time_point::max().time_since_epoch().count()
+            && Clock::now().time_since_epoch().count() >= dl)
+            return true;
+
+        return parent && parent->isCancelled();
+    }
+
+    void cancel()
+    {
+        if (cancelled.exchange(true))
+            return;
+
+        decltype(callbacks) cbs;
+        {
+            lock_guard lock(callbacks_mutex);
+            swap(cbs, callbacks);
+        }
+
+        for (auto &[id, callback] : cbs)
+            try {
+                callback();
+            } catch (const exception &e) {
+                WARN << "Cancellation callback threw exception:" << e.what();
+            } catch (...) {
+                WARN << "Cancellation callback threw unknown exception.";
+            }
+    }
+};
+
+CancellationToken::CancellationToken() : d(make_shared<Private>()) {}
+
+bool CancellationToken::isCancelled() const { return d->isCancelled(); }
+
+void CancellationToken::cancel() { d->cancel(); }
+
+CancellationToken::Clock::time_point CancellationToken::deadline() const
+{ return Clock::time_point(Clock::duration(d->deadline.load())); }
+
+void CancellationToken::setDeadline(Clock::time_point tp)
+{ d->deadline = tp.time_since_epoch().count(); }
+
+void CancellationToken::setTimeout(chrono::milliseconds timeout)
+{ setDeadline(Clock::now() + timeout); }
+
+uint CancellationToken::onCancelled(function<void()> callback) const
+{
+    uint id;
+    {
+        lock_guard lock(d->callbacks_mutex);
+        id = d->next_callback_id++;
+        if (!d->cancelled)
+        {
+            d->callbacks.emplace(id, ::move(callback));
+            return id;
+        }
+    }
+
+    callback();  // Already cancelled
+    return id;
+}
+
+void CancellationToken::removeCallback(uint id) const
+{
+    lock_guard lock(d->callbacks_mutex);
+    d->callbacks.erase(id);
+}
+
+CancellationToken CancellationToken::child() const
+{
+    CancellationToken token;
+    token.d = make_shared<Private>(d);
+
+    // Propagate explicit cancellation to the child. Weak, the child may die first.
+    token.d->parent_callback_id = onCancelled([weak = weak_ptr<Private>(token.d)] {
+        if (auto child = weak.lock())
+            child->cancel();
+    });
+
+    return token;
+}
@@ -2,31 +2,48 @@
 
 #include "generatorqueryhandler.h"
 #include "logging.h"
+#include "threadpool.h"
 #include <QCoroGenerator>
 #include <QFutureWatcher>
 #include <QtConcurrentRun>
 #include <albert/queryexecution.h>
+#include <deque>
 using namespace Qt::StringLiterals;
 using namespace albert;
 using namespace std;
 
+namespace
+{
+// Set by the execution for the generator step running in this thread
+thread_local uint current_batch_size = 10;
+}
+
 GeneratorQueryHandler::~GeneratorQueryHandler() {}
 
+uint GeneratorQueryHandler::batchSize() { return current_batch_size; }
+
+uint GeneratorQueryHandler::readAhead() const { return 0; }
+
 class GeneratorQueryHandlerExecution final : public QueryExecution
 {
-    QFutureWatcher<vector<shared_ptr<Item>>> watcher;  // implicit active flag
+    QFutureWatcher<vector<shared_ptr<Item>>> watcher;
     GeneratorQueryHandler &handler;
     ItemGenerator generator;  // mutexed
     optional<ItemGenerator::iterator> iterator;  // mutexed
-    bool active;
+    const uint read_ahead;
+    deque<vector<shared_ptr<Item>>> prefetched;  // Bounded by read_ahead
+    uint batch_size;  // Of the last requested batch, reused by read-ahead steps
+    bool active;  // A fetch has been requested and is not satisfied yet
+    bool stepping;  // A generator step is running
     // items(), begin and operator++ are potentially long blocking operations.
     // it had to be mutexed because canFetchMore may check the iterator in the main thread.
     // awaiting the lock however blocks the main thread potentially long.
     // store a simple atomic at_end flag to avoid this.
     // now theres only generator and iterator left that are touched in the thread
-    // due to the active flag they will never run concurrently
+    // due to the stepping flag they will never run concurrently
     // so we dont actually need to mutex them at all
     atomic_bool at_end;
+    atomic_bool cancelled;  // cancel() may be called without the query being cancelled
 
 public:
 
@@ -34,22 +51,18 @@ public:
         : QueryExecution(ctx)
         , handler(h)
         , iterator(nullopt)
+        , read_ahead(h.readAhead())
+        , batch_size(0)
         , active(true)
+        , stepping(false)
         , at_end(false)
+        , cancelled(false)
     {
         connect(&watcher, &QFutureWatcher<void>::finished,
-                this, &GeneratorQueryHandlerExecution::onFetchFinished);
+                this, &GeneratorQueryHandlerExecution::onStepFinished);
 
-        watcher.setFuture(QtConcurrent::run([this] -> vector<shared_ptr<Item>>
-        {
-            // `items()` could also be a regular function that returns a generator.
-            // This function should as well run in the thread.
-            generator = handler.items(context);
-            iterator = generator.begin();
-            if (iterator != generator.end())
-                return ::move(*iterator.value());
-            return {};
-        }));
+        // Queued, such that the frontend can set the viewport size for the first batch
+        QMetaObject::invokeMethod(this, [this]{ step(true); }, Qt::QueuedConnection);
     }
 
     ~GeneratorQueryHandlerExecution()
@@ -70,37 +83,104 @@ public:
         }
     }
 
-    void cancel() override { }
+    // The running generator step can not be interrupted. Prevent further steps and drop results.
+    void cancel() override
+    {
+        cancelled = true;
+        prefetched.clear();
+
+        // Report a running read-ahead step, owners await inactivity before deleting executions
+        if (stepping && !active)
+            emit activeChanged(active = true);
+    }
+
+    bool isValid() const { return !cancelled && context.isValid(); }
 
     bool isActive() const override { return active; }
 
-    bool canFetchMore() const override { return context.isValid() && !at_end; }
+    bool canFetchMore() const override
+    { return isValid() && (!prefetched.empty() || !at_end); }
 
     void fetchMore() override
     {
-        if (!isActive() && canFetchMore())
+        if (isActive() || !canFetchMore())
+            return;
+
+        if (prefetched.empty())
         {
             emit activeChanged(active = true);
-            watcher.setFuture(QtConcurrent::run([this] -> vector<shared_ptr<Item>>
-            {
-                ++*iterator;
-                if (iterator != generator.end())
-                    return ::move(*iterator.value());
-                return {};
-            }));
+            if (!stepping)
+                step(true);
+        }
+        else
+        {
+            // Served from the read-ahead queue without thread hop
+            emit activeChanged(active = true);
+            auto items = ::move(prefetched.front());
+            prefetched.pop_front();
+            results.add(::move(items));
+            emit activeChanged(active = false);
+            readAhead();
         }
     }
 
-    void onFetchFinished()
+private:
+
+    // Advances the generator in a worker thread. Only _requested_ batches advance the growth.
+    void step(bool requested)
     {
-        if (context.isValid())
+        if (requested)
+            batch_size = nextBatchSize();
+
+        stepping = true;
+        watcher.setFuture(QtConcurrent::run(&interactiveThreadPool(),
+                                            [this, batch_size = batch_size]
+                                            -> vector<shared_ptr<Item>>
+        {
+            if (!isValid())
+                return {};
+
+            current_batch_size = batch_size;
+
+            if (iterator)
+                ++*iterator;
+            else
+            {
+                // `items()` could also be a regular function that returns a generator.
+                // This function should as well run in the thread.
+                generator = handler.items(context);
+                if (!isValid())
+                    return {};
+                iterator = generator.begin();
+            }
+
+            if (iterator != generator.end())
+                return ::move(*iterator.value());
+            return {};
+        }));
+    }
+
+    // Keeps stepping until the read-ahead queue is full
+    void readAhead()
+    {
+        if (!stepping && isValid() && !at_end && prefetched.size() < read_ahead)
+            step(false);
+    }
+
+    void onStepFinished()
+    {
+        stepping = false;
+
+        if (isValid())
             try {
                 try {
                     auto items = watcher.future().takeResult();
                     if (items.empty())
                         at_end = true;
-                    else
+                    else if (active)
                         results.add(::move(items));
+                    else
+                        prefetched.emplace_back(::move(items));
                 } catch (const QUnhandledException &que) {
                     if (que.exception())
                         rethrow_exception(que.exception());
@@ -109,11 +189,16 @@ public:
                 }
             } catch (const exception &e) {
                 WARN << u"GeneratorQueryHandler threw exception:\n"_s << e.what();
+                at_end = true;
             } catch (...) {
                 WARN << u"GeneratorQueryHandler threw unknown exception."_s;
+                at_end = true;
             }
 
-        emit activeChanged(active = false);
+        if (active)
+            emit activeChanged(active = false);
+
+        readAhead();
     }
 };
 
@@ -1,12 +1,23 @@
 // Copyright (c) 2022-2025 Manuel Schneider
 
+#include "cancellationtoken.h"
 #include "globalquery.h"
 #include "globalqueryexecution.h"
+#include "globalqueryhandler.h"
+#include "logging.h"
+#include "usagescoring.h"
+#include <limits>
 #include <ranges>
 using namespace Qt::StringLiterals;
 using namespace albert;
+using namespace std::chrono;
 using namespace std;
 
+namespace
+{
+static const double statistics_smoothing = 0.2;  // Weight of the latest sample
+}
+
 QString GlobalQuery::id() const { return u"globalquery"_s; }
 
 QString GlobalQuery::name() const { return u"Global query"_s; }
@@ -14,11 +25,103 @@ QString GlobalQuery::name() const { return u"Global query"_s; }
 QString GlobalQuery::description() const { return u"Runs a bunch of global query handlers"_s; }
 
 unique_ptr<QueryExecution> GlobalQuery::execution(QueryContext &ctx)
+{ return make_unique<GlobalQueryExecution>(ctx, *this, schedule()); }
+
+QString GlobalQuery::synopsis(const QString &query) const
+{ return query == u"*"_s ? u"🕚"_s : u""_s; }
+
+milliseconds GlobalQuery::budget(const QString &id) const
+{
+    if (const auto it = budgets.find(id); it != budgets.end())
+        return it->second;
+    return default_budget;
+}
+
+vector<GlobalQuery::ScheduledHandler> GlobalQuery::schedule() const
 {
+    vector<pair<double, ScheduledHandler>> prioritized;
+    for (const auto &[id, handler] : handlers)
+    {
+        // Unknown handlers get the highest priority to gather statistics quickly
+        double priority = numeric_limits<double>::max();
+        if (const auto it = statistics.find(id); it != statistics.end() && it->second.samples)
+            priority = it->second.hit_rate / (1. + it->second.duration);
+        prioritized.emplace_back(priority, ScheduledHandler{handler, budget(id)});
+    }
+
+    // Stable, keeps the id order for equal priorities
+    ranges::stable_sort(prioritized, greater{}, &decltype(prioritized)::value_type::first);
+
     // FIXME ranges::to
-    auto v = handlers | views::values;
-    return make_unique<GlobalQueryExecution>(ctx, vector<GlobalQueryHandler*>{begin(v), end(v)});
+    auto v = prioritized | views::values;
+    return {begin(v), end(v)};
 }
 
-QString GlobalQuery::synopsis(const QString &query) const
-{ return query == u"*"_s ? u"🕚"_s : u""_s; }
+void GlobalQuery::updateStatistics(const QString &id, uint duration, uint item_count)
+{
+    auto &s = statistics[id];
+    const double hit = item_count > 0 ? 1. : 0.;
+    if (s.samples++ == 0)
+    {
+        s.duration = duration;
+        s.hit_rate = hit;
+    }
+    else
+    {
+        s.duration += statistics_smoothing * (duration - s.duration);
+        s.hit_rate += statistics_smoothing * (hit - s.hit_rate);
+    }
+}
+
+GlobalQuery::EmptyQueryResults
+GlobalQuery::rankEmptyQuery(const vector<GlobalQueryHandler*> &handlers,
+                            const UsageScoring &usage_scoring,
+                            const CancellationToken &token)
+{
+    EmptyQueryResults empty_query_results;
+
+    for (auto *handler : handlers)
+    {
+        if (token.isCancelled())
+            break;
+
+        // Fetch the generation first. Concurrent changes make the results outdated, not lost.
+        empty_query_results.handler_generations.emplace_back(handler, handler->resultGeneration());
+
+        try {
+            vector<RankItem> rank_items;
+            for (auto &item : handler->handleEmptyQuery())
+                rank_items.emplace_back(::move(item), 0);
+
+            usage_scoring.modifyMatchScores(handler->id(), rank_items);
+
+            for (auto &rank_item : rank_items)
+                empty_query_results.results.emplace_back(handler, ::move(rank_item));
+        }
+        catch (const exception &e) {
+            WARN << u"GlobalQueryHandler '%1' threw exception:\n"_s.arg(handler->id()) << e.what();
+        }
+        catch (...) {
+            WARN << u"GlobalQueryHandler '%1' threw unknown exception:\n"_s.arg(handler->id());
+        }
+    }
+
+    ranges::stable_sort(empty_query_results.results, less{}, &GlobalQueryResult::rank_item);
+
+    return empty_query_results;
+}
+
+bool GlobalQuery::emptyQueryResultsVolatile() const
+{
+    return empty_query_results
+           && ranges::any_of(empty_query_results->handler_generations,
+                             [](const auto &p) { return p.second == 0; });
+}
+
+bool GlobalQuery::emptyQueryResultsOutdated() const
+{
+    return empty_query_results
+           && ranges::any_of(empty_query_results->handler_generations, [](const auto &p) {
+                  return p.second != p.first->resultGeneration();
+              });
+}
@@ -2,14 +2,83 @@
 
 #pragma once
 #include "queryhandler.h"
+#include "querymetrics.h"
+#include "rankitem.h"
+#include "resultcache.h"
 #include <QString>
+#include <chrono>
 #include <map>
-namespace albert { class GlobalQueryHandler; }
+#include <memory>
+#include <vector>
+namespace albert {
+class CancellationToken;
+class GlobalQueryHandler;
+class UsageScoring;
+}
+
+struct GlobalQueryResult
+{
+    albert::GlobalQueryHandler *handler;
+    albert::RankItem rank_item;
+};
 
 class GlobalQuery : public albert::QueryHandler
 {
 public:
+
+    // Rolling per handler statistics used for scheduling
+    struct HandlerStatistics
+    {
+        double duration = 0.;  // Moving average of the handling duration in ms
+        double hit_rate = 1.;  // Moving average of the ratio of queries yielding items
+        uint samples = 0;
+    };
+
+    struct ScheduledHandler
+    {
+        albert::GlobalQueryHandler *handler;
+        std::chrono::milliseconds budget;  // Zero if unlimited
+    };
+
+    // Usage scored results of the empty query, precomputed off the critical path
+    struct EmptyQueryResults
+    {
+        uint generation = 0;  // Of the engine state the results were built from
+        std::vector<std::pair<albert::GlobalQueryHandler*, uint>> handler_generations;
+        std::vector<GlobalQueryResult> results;  // Ascending, i.e. best last
+    };
+
     std::map<QString, albert::GlobalQueryHandler *> handlers;
+    std::map<QString, std::chrono::milliseconds> budgets;  // Overrides of default_budget
+    std::chrono::milliseconds default_budget{0};
+    bool drop_overrun_results = false;
+    bool deduplicate = false;  // Merge results with equal item identity
+    ResultCache cache{16 * 1024 * 1024};
+    std::map<QString, HandlerStatistics> statistics;
+    QueryMetrics metrics;
+    std::shared_ptr<const EmptyQueryResults> empty_query_results;  // Null if invalidated
+
+    ///
+    /// Runs the empty query of _handlers_ and returns the usage scored, sorted results. Blocking.
+    ///
+    /// Stops before the next handler if _token_ is cancelled. The results are incomplete then.
+    ///
+    static EmptyQueryResults rankEmptyQuery(const std::vector<albert::GlobalQueryHandler*> &handlers,
+                                            const albert::UsageScoring &usage_scoring,
+                                            const albert::CancellationToken &token);
+
+    /// Returns `true` if a handler announced new results since the empty query results were built.
+    bool emptyQueryResultsOutdated() const;
+
+    /// Returns `true` if the empty query results contain results of handlers without generation.
+    bool emptyQueryResultsVolatile() const;
+
+    std::chrono::milliseconds budget(const QString &id) const;
+
+    /// Returns the enabled handlers, historically fast and high-hit handlers first.
+    std::vector<ScheduledHandler> schedule() const;
+
+    void updateStatistics(const QString &id, uint duration, uint item_count);
 
 private:
     QString id() const override;
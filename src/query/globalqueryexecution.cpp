@@ -1,92 +1,324 @@
 // Copyright (c) 2022-2025 Manuel Schneider
 
+#include "cancellationtoken.h"
 #include "color.h"
 #include "globalqueryexecution.h"
 #include "globalqueryhandler.h"
+#include "icon.h"
 #include "logging.h"
 #include "rankitem.h"
+#include "threadpool.h"
+#include "trace.h"
 #include "usagescoring.h"
 #include <QFutureWatcher>
+#include <QTimer>
 #include <QtConcurrentMap>
 #include <chrono>
 #include <ranges>
+#include <set>
+#include <unordered_map>
 #include <vector>
 using namespace Qt::StringLiterals;
 using namespace albert;
 using namespace std::chrono;
 using namespace std;
 
-struct GlobalQueryResult
-{
-    GlobalQueryHandler *handler;
-    RankItem rank_item;
-};
-
 struct MappedData {
     GlobalQueryHandler *handler;
-    mutable vector<RankItem> rank_items;
-    uint handling_duration;
-    uint scoring_duration;
+    shared_ptr<vector<RankItem>> rank_items;  // Shared with the result store of the future
+    uint handling_duration;  // µs
+    uint scoring_duration;  // µs
+    bool overrun;
+    bool cached;
 };
 
-//V function(T &result, const U &intermediate)
+// Results of the handlers that finished before the results are published
 struct ReducedData {
     struct Diagnostics {
         albert::GlobalQueryHandler *handler;
-        uint handling_runtime = 0;
-        uint scoring_runtime = 0;
+        uint handling_runtime = 0;  // µs
+        uint scoring_runtime = 0;  // µs
         uint item_count = 0;
+        bool overrun = false;
+        bool cached = false;
     };
     vector<Diagnostics> handler_diag;
     vector<GlobalQueryResult> results;
+    unordered_map<QString, size_t> identities;  // Item identity to index in results
+    uint merged_count = 0;
+};
+
+static QString diagnosticsLine(const ReducedData::Diagnostics &diag)
+{
+    static const auto body = color::blue + u"│%1 ms│%2 ms│%3│ %4"_s + color::reset;
+    return body.arg(diag.handling_runtime / 1000., 6, 'f', 1)
+        .arg(diag.scoring_runtime / 1000., 6, 'f', 1)
+        .arg(diag.item_count, 6)
+        .arg(diag.overrun ? diag.handler->id() + u" (overrun)"_s
+             : diag.cached ? diag.handler->id() + u" (cached)"_s
+                           : diag.handler->id());
+}
+
+// An item presenting the actions of duplicates of other handlers along with its own
+class MergedItem final : public Item, private Item::Observer
+{
+public:
+    MergedItem(shared_ptr<Item> item) : primary(::move(item)) {}
+
+    ~MergedItem() override
+    {
+        if (!observers.empty())
+            primary->removeObserver(this);
+    }
+
+    void merge(shared_ptr<Item> item) { duplicates.emplace_back(::move(item)); }
+
+    QString id() const override { return primary->id(); }
+    QString text() const override { return primary->text(); }
+    QString subtext() const override { return primary->subtext(); }
+    QString inputActionText() const override { return primary->inputActionText(); }
+    unique_ptr<Icon> icon() const override { return primary->icon(); }
+    QString identity() const override { return primary->identity(); }
+
+    vector<Action> actions() const override
+    {
+        auto actions = primary->actions();
+        for (const auto &duplicate : duplicates)
+            for (auto &action : duplicate->actions())
+                if (ranges::none_of(actions, [&](const auto &a){ return a.id == action.id; }))
+                    actions.emplace_back(::move(action));
+        return actions;
+    }
+
+    void addObserver(Observer *observer) override
+    {
+        if (observers.empty())
+            primary->addObserver(this);
+        observers.insert(observer);
+    }
+
+    void removeObserver(Observer *observer) override
+    {
+        observers.erase(observer);
+        if (observers.empty())
+            primary->removeObserver(this);
+    }
+
+private:
+
+    void onItemChanged(const Item *) override
+    {
+        for (auto *observer : observers)
+            observer->onItemChanged(this);
+    }
+
+    const shared_ptr<Item> primary;
+    vector<shared_ptr<Item>> duplicates;
+    set<Observer*> observers;
+};
+
+// Merges _result_ into an existing result with the same identity. Returns false if there is none.
+static bool mergeDuplicate(ReducedData &reduced, GlobalQueryResult &result)
+{
+    auto identity = result.rank_item.item->identity();
+    if (identity.isEmpty())
+        return false;
+
+    const auto &[it, inserted] = reduced.identities.emplace(::move(identity),
+                                                            reduced.results.size());
+    if (inserted)
+        return false;
+
+    // The higher scored item is presented, the other contributes its actions
+    auto &existing = reduced.results[it->second];
+    if (existing.rank_item < result.rank_item)
+        swap(existing, result);
+
+    auto merged = dynamic_pointer_cast<MergedItem>(existing.rank_item.item);
+    if (!merged)
+        existing.rank_item.item = merged = make_shared<MergedItem>(existing.rank_item.item);
+    merged->merge(::move(result.rank_item.item));
+
+    ++reduced.merged_count;
+    return true;
+}
+
+// Query context of a single handler. Cancelled when the query is or the budget is exhausted.
+class HandlerContext final : public QueryContext
+{
+public:
+    HandlerContext(const QueryContext &c, milliseconds budget)
+        : context(c)
+        , token(c.cancellationToken().child())
+    {
+        if (budget.count() > 0)
+            token.setTimeout(budget);
+    }
+
+    bool isValid() const override { return !token.isCancelled(); }
+    const CancellationToken &cancellationToken() const override { return token; }
+    const QueryHandler &handler() const override { return context.handler(); }
+    QString query() const override { return context.query(); }
+    QString trigger() const override { return context.trigger(); }
+    const UsageScoring &usageScoring() const override { return context.usageScoring(); }
+
+private:
+    const QueryContext &context;
+    CancellationToken token;
 };
 
 class GlobalQueryExecution::Private
 {
 public:
-    Private(GlobalQueryExecution *, vector<albert::GlobalQueryHandler *>);
+    Private(GlobalQueryExecution *, GlobalQuery &, vector<GlobalQuery::ScheduledHandler>);
 
+    void onHandlerFinished(const MappedData &mapped);
+    void publish();
     void addResultChunk();
 
     GlobalQueryExecution *q;
-    const vector<albert::GlobalQueryHandler*> handlers;
+    GlobalQuery &global_query;
+    vector<GlobalQuery::ScheduledHandler> handlers;
     bool active;
 
-    QFutureWatcher<ReducedData> future_watcher;
+    QFutureWatcher<MappedData> future_watcher;
+    QTimer deadline_timer;
 
+    ReducedData reduced;
     vector<GlobalQueryResult> unordered_results;
+    vector<GlobalQueryResult> deferred_results;  // Of handlers that overran their budget
+    bool published = false;  // Results are fetchable
+    bool fetching = false;
     chrono::time_point<chrono::system_clock> start_timepoint;
     chrono::time_point<chrono::system_clock> finish_timepoint;
+    bool first_chunk = true;
+    const Trace::Clock::time_point trace_timepoint = Trace::Clock::now();
+    const uint cache_epoch;  // Of the usage scoring the query got
 };
 
 GlobalQueryExecution::Private::Private(GlobalQueryExecution *execution,
-                                       vector<GlobalQueryHandler *> h) :
+                                       GlobalQuery &gq,
+                                       vector<GlobalQuery::ScheduledHandler> h) :
     q(execution),
+    global_query(gq),
     handlers(::move(h)),
-    active(true)
+    active(true),
+    cache_epoch(gq.cache.epoch())
 {
     start_timepoint = system_clock::now();
 
-    auto future = QtConcurrent::mappedReduced(
+    // Precomputed by the engine. Do not run handler code when the launcher shows up. Handlers
+    // enabled after the precomputation run live.
+    if (q->context.query().isEmpty() && global_query.empty_query_results)
+    {
+        // Sorted ascending already, which makes the partial sort of each chunk cheap
+        unordered_results = global_query.empty_query_results->results;
+
+        const auto &precomputed = global_query.empty_query_results->handler_generations;
+        erase_if(handlers, [&](const auto &scheduled) {
+            return ranges::any_of(precomputed, [&](const auto &p){ return p.first == scheduled.handler; });
+        });
+
+        if (handlers.empty())
+        {
+            // Queued, the query is not connected to the frontend yet
+            QMetaObject::invokeMethod(q, [this] {
+                published = true;
+                if (q->isValid())
+                {
+                    DEBG << u"Query #%1 serves %2 precomputed empty query results"_s
+                                .arg(q->id).arg(unordered_results.size());
+                    addResultChunk();
+                }
+                emit q->activeChanged(active = false);
+            }, Qt::QueuedConnection);
+
+            return;
+        }
+    }
+
+    // The results are published when all handlers finished, but not later than the largest
+    // budget. The query stays active until the overrunning handlers returned.
+    if (!handlers.empty()
+        && ranges::none_of(handlers, [](const auto &s){ return s.budget.count() == 0; }))
+    {
+        deadline_timer.setSingleShot(true);
+        deadline_timer.setInterval(
+            ranges::max(handlers, {}, &GlobalQuery::ScheduledHandler::budget).budget);
+        QObject::connect(&deadline_timer, &QTimer::timeout, q, [this]{ publish(); });
+        deadline_timer.start();
+    }
+
+    QObject::connect(&future_watcher, &QFutureWatcher<MappedData>::resultReadyAt, q,
+                     [this](int index){ onHandlerFinished(future_watcher.resultAt(index)); });
+
+    QObject::connect(&future_watcher, &QFutureWatcher<MappedData>::finished, q, [this] {
+        // Canceled futures have no result. Still emit activeChanged, the query may be waiting
+        // for it to be deleted.
+        publish();
+        emit q->activeChanged(active = false);
+    });
+
+    // The handlers are sorted by priority. The pool picks them up in order.
+    future_watcher.setFuture(QtConcurrent::mapped(
+        &interactiveThreadPool(),
         handlers,
-        [this](GlobalQueryHandler *handler) -> MappedData {
+        [this, drop_overruns = global_query.drop_overrun_results]
+        (const GlobalQuery::ScheduledHandler &scheduled) -> MappedData {
+            auto *handler = scheduled.handler;
+
             // 6.4 Still no move semantics in QtConcurrent
             MappedData data{.handler = handler,
-                            .rank_items = {},
+                            .rank_items = make_shared<vector<RankItem>>(),
                             .handling_duration = 0,
-                            .scoring_duration = 0};
+                            .scoring_duration = 0,
+                            .overrun = false,
+                            .cached = false};
+
+            // Skip the remaining handlers of a stale query
+            if (!q->isValid())
+                return data;
+
             try {
+                Trace::Span span("query", "handler", handler->id());
+
+                // Cached results are usage scored already
+                const auto generation = handler->resultGeneration();
+                if (generation && !q->context.query().isEmpty())
+                    if (auto cached = global_query.cache.get(handler->id(), q->query(), generation))
+                    {
+                        *data.rank_items = ::move(*cached);
+                        data.cached = true;
+                        return data;
+                    }
+
                 auto t = system_clock::now();
+                bool complete = true;
                 if (q->context.query().isEmpty()) // important redirection
                     for (auto &item : handler->handleEmptyQuery()) // order ???
-                        data.rank_items.emplace_back(::move(item), 0);
+                        data.rank_items->emplace_back(::move(item), 0);
                 else
-                    data.rank_items = handler->rankItems(*q);
-                data.handling_duration = duration_cast<milliseconds>(system_clock::now()-t).count();
+                {
+                    // Cancelled at the budget only if the results would be dropped anyway.
+                    // Otherwise the handler completes and its results are appended late.
+                    HandlerContext handler_context(*q, drop_overruns ? scheduled.budget
+                                                                     : milliseconds(0));
+                    *data.rank_items = handler->rankItems(handler_context);
+                    complete = handler_context.isValid();
+                }
+                data.handling_duration = duration_cast<microseconds>(system_clock::now()-t).count();
+                data.overrun = scheduled.budget.count() > 0
+                               && data.handling_duration
+                                      > duration_cast<microseconds>(scheduled.budget).count();
 
                 t = system_clock::now();
-                q->usageScoring().modifyMatchScores(handler->id(), data.rank_items);
-                data.scoring_duration = duration_cast<milliseconds>(system_clock::now()-t).count();
+                q->usageScoring().modifyMatchScores(handler->id(), *data.rank_items);
+                data.scoring_duration = duration_cast<microseconds>(system_clock::now()-t).count();
+
+                // Results of cancelled handlers may be incomplete
+                if (generation && complete && !q->context.query().isEmpty())
+                    global_query.cache.put(handler->id(), q->query(), generation,
+                                           cache_epoch, *data.rank_items);
             }
             catch (const exception &e) {
                 WARN << u"GlobalQueryHandler '%1' threw exception:\n"_s.arg(handler->id()) << e.what();
@@ -96,57 +328,115 @@ GlobalQueryExecution::Private::Private(GlobalQueryExecution *execution,
             }
 
             return data;
-        },
-        [](ReducedData &reduced, const MappedData &mapped) {
-            reduced.handler_diag.emplace_back(mapped.handler,
-                                              mapped.handling_duration,
-                                              mapped.scoring_duration,
-                                              mapped.rank_items.size());
-            reduced.results.reserve(reduced.results.size() + mapped.rank_items.size());
-            for (auto &&rank_item : mapped.rank_items)
-                reduced.results.emplace_back(mapped.handler, ::move(rank_item));
-        }
-    );
-
-    QObject::connect(&future_watcher, &QFutureWatcher<ReducedData>::finished, q, [this] {
-        if (q->isValid())
-        {
-            auto reduced = future_watcher.future().takeResult();
+        }));
+}
 
-            const auto total_duration = duration_cast<milliseconds>(system_clock::now() - start_timepoint).count();
+void GlobalQueryExecution::Private::onHandlerFinished(const MappedData &mapped)
+{
+    // Moved, the future keeps its results until destruction
+    auto rank_items = ::move(*mapped.rank_items);
+
+    if (!q->isValid())
+        return;
+
+    // Handlers finishing after the results were published are overrunning the deadline
+    const ReducedData::Diagnostics diag{mapped.handler,
+                                        mapped.handling_duration,
+                                        mapped.scoring_duration,
+                                        (uint)rank_items.size(),
+                                        mapped.overrun || published,
+                                        mapped.cached};
+
+    // Empty query and cache hit timings are not representative
+    if (!q->context.query().isEmpty() && !diag.cached)
+    {
+        global_query.updateStatistics(diag.handler->id(), diag.handling_runtime / 1000,
+                                      diag.item_count);
+        global_query.metrics.addHandlerSample(diag.handler->id(),
+                                              diag.handling_runtime,
+                                              diag.scoring_runtime,
+                                              diag.item_count);
+    }
 
-            static const auto header  = color::blue + u"╭ Handling╷  Scoring╷ Count╷ Query #%1 '%2'"_s + color::reset;
-            static const auto body    = color::blue + u"│%1 ms│%2 ms│%3│ %4"_s + color::reset;
-            static const auto footer  = color::blue + u"╰%1 ms╵         ╵%2╵ TOTAL"_s + color::reset;
+    if (published)
+        DEBG << diagnosticsLine(diag);
+    else
+        reduced.handler_diag.emplace_back(diag);
 
-            DEBG << header.arg(q->id).arg(q->context.query());
-            for (const auto &diag : reduced.handler_diag)
-                DEBG << body.arg(diag.handling_runtime, 6)
-                            .arg(diag.scoring_runtime, 6)
-                            .arg(diag.item_count, 6)
-                            .arg(diag.handler->id());
-            DEBG << footer.arg(total_duration, 6).arg(reduced.results.size(), 6);
+    if (!diag.overrun)
+    {
+        reduced.results.reserve(reduced.results.size() + rank_items.size());
+        for (auto &rank_item : rank_items)
+        {
+            GlobalQueryResult result{mapped.handler, ::move(rank_item)};
+            if (!global_query.deduplicate || !mergeDuplicate(reduced, result))
+                reduced.results.emplace_back(::move(result));
+        }
+    }
+    else if (!global_query.drop_overrun_results)
+    {
+        // Presented right away if the frontend fetched everything else already
+        const bool drained = published && unordered_results.empty() && deferred_results.empty();
 
-            unordered_results = ::move(reduced.results);
+        deferred_results.reserve(deferred_results.size() + rank_items.size());
+        for (auto &rank_item : rank_items)
+            deferred_results.emplace_back(GlobalQueryResult{mapped.handler, ::move(rank_item)});
 
-            // Required because while active fetchMore has no effect
+        if (drained && !fetching && !deferred_results.empty())
             addResultChunk();
-        }
-
-        emit q->activeChanged(active = false);
-    });
+    }
+}
 
-    future_watcher.setFuture(future);
+void GlobalQueryExecution::Private::publish()
+{
+    if (published)
+        return;
+    published = true;
+    deadline_timer.stop();
+
+    if (!q->isValid() || future_watcher.isCanceled())
+        return;
+
+    const auto total_duration = duration_cast<milliseconds>(system_clock::now() - start_timepoint).count();
+
+    static const auto header  = color::blue + u"╭ Handling╷  Scoring╷ Count╷ Query #%1 '%2'"_s + color::reset;
+    static const auto footer  = color::blue + u"╰%1 ms╵         ╵%2╵ TOTAL"_s + color::reset;
+
+    DEBG << header.arg(q->id).arg(q->context.query());
+    for (const auto &diag : reduced.handler_diag)
+        DEBG << diagnosticsLine(diag);
+    DEBG << footer.arg(total_duration, 6).arg(reduced.results.size(), 6);
+    if (reduced.merged_count)
+        DEBG << u"Merged %1 duplicates"_s.arg(reduced.merged_count);
+    if (const auto late = handlers.size() - reduced.handler_diag.size(); late)
+        DEBG << u"Published without %1 handlers overrunning the deadline"_s.arg(late);
+
+    // Appended to the precomputed empty query results, if any
+    unordered_results.insert(unordered_results.end(),
+                             make_move_iterator(reduced.results.begin()),
+                             make_move_iterator(reduced.results.end()));
+    reduced = {};
+
+    // The length only, traces are shared in bug reports
+    Trace::record("query", "global", QString::number(q->context.query().size()),
+                  trace_timepoint);
+
+    addResultChunk();
 }
 
 void GlobalQueryExecution::Private::addResultChunk()
 {
+    Trace::Span span("query", "fetch");
     auto tp = system_clock::now();
 
+    // Results of handlers that overran their budget come last
+    if (unordered_results.empty())
+        swap(unordered_results, deferred_results);
+
     // Partial sort the items incrementally in reverse order (for cheap "pop_n")
     auto reverse_view = unordered_results | views::reverse;
 
-    auto fetch_view = reverse_view | views::take(10);
+    auto fetch_view = reverse_view | views::take(static_cast<int>(q->nextBatchSize()));
 
     ranges::partial_sort(reverse_view, fetch_view.end(), greater{}, &GlobalQueryResult::rank_item);
 
@@ -160,25 +450,41 @@ void GlobalQueryExecution::Private::addResultChunk()
     // Cheap pop_n
     unordered_results.erase(unordered_results.end() - fetch_view.size(), unordered_results.end());
 
-    const auto duration_sort = duration_cast<milliseconds>(system_clock::now() - tp).count();
+    const auto now = system_clock::now();
+    const auto duration_sort = duration_cast<milliseconds>(now - tp).count();
     DEBG << u"Fetched %1 items in %2 ms"_s.arg(taken.size()).arg(duration_sort);
 
+    global_query.metrics.fetch.add(duration_cast<microseconds>(now - tp).count());
+    if (first_chunk && !taken.empty())
+    {
+        first_chunk = false;
+        global_query.metrics.first_chunk.add(
+            duration_cast<milliseconds>(now - start_timepoint).count());
+    }
+
     // Query::add emits model signals that may lead to fetchMore recursions.
     // Ensure unfetched_rank_items integrity _before adding_!
+    fetching = true;
     q->results.add(::move(taken));
+    fetching = false;
 }
 
 // -------------------------------------------------------------------------------------------------
 
-GlobalQueryExecution::GlobalQueryExecution(QueryContext &c, vector<GlobalQueryHandler*> h)
+GlobalQueryExecution::GlobalQueryExecution(QueryContext &c,
+                                           GlobalQuery &gq,
+                                           vector<GlobalQuery::ScheduledHandler> h)
     : QueryExecution(c)
-    , d(make_unique<Private>(this, ::move(h)))
+    , d(make_unique<Private>(this, gq, ::move(h)))
 {}
 
 GlobalQueryExecution::~GlobalQueryExecution()
 {
     cancel();
 
+    // The mapped function uses this execution as query context. Usually the query engine retires
+    // queries not before their execution is inactive. If not, e.g. on app exit, we have to wait.
+
     // Qt 6.4 QFutureWatcher is broken.
     // isFinished returns wrong values and waitForFinished blocks forever on finished futures.
     // TODO(26.04): Remove workaround when dropping Qt < 6.5 support.
@@ -195,6 +501,9 @@ GlobalQueryExecution::~GlobalQueryExecution()
 
 bool GlobalQueryExecution::isValid() const { return context.isValid(); }
 
+const CancellationToken &GlobalQueryExecution::cancellationToken() const
+{ return context.cancellationToken(); }
+
 const QueryHandler &GlobalQueryExecution::handler() const { return context.handler(); }
 
 QString GlobalQueryExecution::query() const
@@ -207,13 +516,25 @@ const albert::UsageScoring &GlobalQueryExecution::usageScoring() const
 
 void GlobalQueryExecution::cancel()
 {
-    disconnect(&d->future_watcher, &QFutureWatcher<ReducedData>::finished, this, nullptr);
     d->future_watcher.cancel();
+    d->deadline_timer.stop();
+
+    // Unfetched results are of no use anymore. Release the items early.
+    d->unordered_results.clear();
+    d->unordered_results.shrink_to_fit();
+    d->deferred_results.clear();
+    d->deferred_results.shrink_to_fit();
 }
 
 void GlobalQueryExecution::fetchMore()
 {
-    if (!isActive() && canFetchMore())
+    // Published results are fetchable while overrunning handlers are still running
+    if (!d->published || d->fetching || !canFetchMore())
+        return;
+
+    if (isActive())
+        d->addResultChunk();
+    else
     {
         emit activeChanged(d->active = true);
         d->addResultChunk();
@@ -221,7 +542,8 @@ void GlobalQueryExecution::fetchMore()
     }
 }
 
-bool GlobalQueryExecution::canFetchMore() const { return !d->unordered_results.empty(); }
+bool GlobalQueryExecution::canFetchMore() const
+{ return !d->unordered_results.empty() || !d->deferred_results.empty(); }
 
 bool GlobalQueryExecution::isActive() const { return d->active; }
 
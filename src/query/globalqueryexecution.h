@@ -1,6 +1,7 @@
 // Copyright (c) 2022-2025 Manuel Schneider
 
 #pragma once
+#include "globalquery.h"
 #include "querycontext.h"
 #include "queryexecution.h"
 #include <memory>
@@ -10,13 +11,15 @@ class GlobalQueryExecution final : public albert::QueryExecution, public albert:
 {
 public:
     GlobalQueryExecution(albert::QueryContext &context,
-                         std::vector<albert::GlobalQueryHandler *> query_handlers);
+                         GlobalQuery &global_query,
+                         std::vector<GlobalQuery::ScheduledHandler> query_handlers);
     ~GlobalQueryExecution();
 
 private:
     // albert::Query
     // Required because we want to handle '*' as empty query and for atomic valid flag
     bool isValid() const override;
+    const albert::CancellationToken &cancellationToken() const override;
     const albert::QueryHandler &handler() const override;
     QString query() const override;
     QString trigger() const override;
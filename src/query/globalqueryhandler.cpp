@@ -7,3 +7,5 @@ using namespace std;
 GlobalQueryHandler::~GlobalQueryHandler() {}
 
 vector<shared_ptr<Item>> GlobalQueryHandler::handleEmptyQuery() { return {}; }
+
+uint GlobalQueryHandler::resultGeneration() const { return 0; }
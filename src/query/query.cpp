@@ -1,5 +1,6 @@
 // Copyright (c) 2023-2024 Manuel Schneider
 
+#include "cancellationtoken.h"
 #include "query.h"
 #include "queryexecution.h"
 #include "queryhandler.h"
@@ -15,7 +16,7 @@ class Query::Private
 public:
     UsageScoring usage_scoring;
 
-    atomic_bool valid;
+    CancellationToken token;
     QueryHandler &handler;
     QString trigger;
     QString string;
@@ -32,7 +33,7 @@ Query::Query(UsageScoring usage_scoring,
              QString trigger,
              QString string) :
     d(new Private{.usage_scoring = ::move(usage_scoring),
-                  .valid = true,
+                  .token = {},
                   .handler = handler,
                   .trigger = trigger,
                   .string = string,
@@ -53,7 +54,7 @@ Query::Query(UsageScoring usage_scoring,
 
 Query::~Query()
 {
-    d->valid = false;
+    d->token.cancel();
 
     // DEBG << QString("Query about to be deleted. [#%1 '%2']").arg(d->execution->id).arg(d->string);
 
@@ -75,13 +76,12 @@ albert::QueryHandler &Query::handler() const { return d->handler; }
 
 albert::QueryExecution &Query::execution() const { return *d->execution; }
 
-bool Query::isValid() const { return d->valid; }
+bool Query::isValid() const { return !d->token.isCancelled(); }
+
+const albert::CancellationToken &Query::cancellationToken() const { return d->token; }
 
 void Query::cancel()
 {
-    if (d->valid)
-    {
-        d->valid = false;
-        d->execution->cancel();
-    }
+    d->token.cancel();  // Idempotent
+    d->execution->cancel();
 }
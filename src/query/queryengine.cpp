@@ -4,15 +4,21 @@
 #include "extensionregistry.h"
 #include "fallbackhandler.h"
 #include "globalqueryhandler.h"
+#include "inputhistory.h"
 #include "logging.h"
 #include "queryengine.h"
+#include "queryexecution.h"
 #include "queryresults.h"
 #include "query.h"
+#include "rankedqueryhandler.h"
+#include "threadpool.h"
 #include "usagedatabase.h"
 #include "usagescoring.h"
 #include <QCoreApplication>
+#include <QEventLoop>
 #include <QMessageBox>
 #include <QSettings>
+#include <set>
 using namespace Qt::StringLiterals;
 using namespace albert;
 using namespace std;
@@ -20,6 +26,20 @@ using namespace std;
 namespace
 {
 static const char*  CFG_GLOBAL_HANDLER_ENABLED = "global_handler_enabled";
+static const char*  CFG_GLOBAL_HANDLER_BUDGET = "global_handler_budget";
+static const char*  CFG_DEFAULT_BUDGET = "globalHandlerBudget";
+static const uint   DEF_DEFAULT_BUDGET = 100;
+static const char*  CFG_DROP_OVERRUNS = "dropOverrunResults";
+static const bool   DEF_DROP_OVERRUNS = false;
+static const char*  CFG_DEDUPLICATE = "deduplicateResults";
+static const bool   DEF_DEDUPLICATE = false;
+static const char*  CFG_RESULT_CACHE_SIZE = "resultCacheSize";
+static const uint   DEF_RESULT_CACHE_SIZE = 16;
+static const char*  CFG_SPECULATIVE_EXECUTION = "speculativeExecution";
+static const bool   DEF_SPECULATIVE_EXECUTION = false;
+static const int    speculation_depth = 3;  // Recent queries warmed up
+static const char*  CFG_SPECULATION_TIMEOUT = "speculationTimeout";
+static const uint   DEF_SPECULATION_TIMEOUT = 10000;  // ms
 static const char*  CFG_FALLBACK_ORDER = "fallback_order";
 static const char*  CFG_FALLBACK_EXTENSION = "extension";
 static const char*  CFG_FALLBACK_ITEM = "fallback";
@@ -32,6 +52,23 @@ static const bool   DEF_PRIO_PERFECT = true;
 }
 
 
+class DeferredQueryHandler : public albert::RankedQueryHandler
+{
+public:
+    QString id_;
+    QString name_;
+    QString description_;
+    QStringList triggers;
+
+    QString id() const override { return id_; }
+    QString name() const override { return name_; }
+    QString description() const override { return description_; }
+    QString defaultTrigger() const override { return triggers.value(0); }
+    bool allowTriggerRemap() const override { return false; }
+    vector<RankItem> rankItems(QueryContext &) override { return {}; }  // Until loaded
+};
+
+
 QueryEngine::QueryEngine(ExtensionRegistry &registry)
     : registry_(registry)
     , usage_scoring_(0,0,{})  // Null scoring, just to not have to implement constructors
@@ -40,12 +77,41 @@ QueryEngine::QueryEngine(ExtensionRegistry &registry)
 
     auto decay = s->value(CFG_MEMORY_DECAY, DEF_MEMORY_DECAY).toDouble();
     auto prioritize_perfect_match = s->value(CFG_PRIO_PERFECT, DEF_PRIO_PERFECT).toBool();
+    global_query_.default_budget =
+        chrono::milliseconds(s->value(CFG_DEFAULT_BUDGET, DEF_DEFAULT_BUDGET).toUInt());
+    global_query_.drop_overrun_results = s->value(CFG_DROP_OVERRUNS, DEF_DROP_OVERRUNS).toBool();
+    global_query_.deduplicate = s->value(CFG_DEDUPLICATE, DEF_DEDUPLICATE).toBool();
+    global_query_.cache.setCapacity(
+        s->value(CFG_RESULT_CACHE_SIZE, DEF_RESULT_CACHE_SIZE).toUInt() * 1024 * 1024);
+    speculative_execution_ =
+        s->value(CFG_SPECULATIVE_EXECUTION, DEF_SPECULATIVE_EXECUTION).toBool();
+
+    recent_queries_ = detail::InputHistory::load().mid(0, speculation_depth);
+
+    speculation_timeout_.setSingleShot(true);
+    speculation_timeout_.setInterval(
+        chrono::milliseconds(s->value(CFG_SPECULATION_TIMEOUT, DEF_SPECULATION_TIMEOUT).toUInt()));
+    connect(&speculation_timeout_, &QTimer::timeout, this, &QueryEngine::discardSpeculations);
     usage_scoring_ = UsageScoring(prioritize_perfect_match, decay,
                                   make_shared<unordered_map<ItemKey, double>>
                                   (UsageDatabase::instance().itemUsageScores(decay)));
 
     loadFallbackOrder();
 
+    connect(&empty_query_watcher_, &QFutureWatcher<GlobalQuery::EmptyQueryResults>::finished,
+            this, [this]
+    {
+        auto empty_query_results = empty_query_watcher_.future().takeResult();
+        if (empty_query_results.generation == empty_query_generation_)
+        {
+            DEBG << "Precomputed" << empty_query_results.results.size() << "empty query results";
+            global_query_.empty_query_results =
+                make_shared<const GlobalQuery::EmptyQueryResults>(::move(empty_query_results));
+        }
+        else
+            rebuildEmptyQueryResults();  // Invalidated meanwhile
+    });
+
     connect(&registry, &ExtensionRegistry::added, this, [this](Extension *e)
     {
         const auto id = e->id();
@@ -72,7 +138,11 @@ QueryEngine::QueryEngine(ExtensionRegistry &registry)
             global_handlers_.emplace(id, h);
             if (settings->value(CFG_GLOBAL_HANDLER_ENABLED, true).toBool())
                 global_query_.handlers.emplace(id, h);
+            if (settings->contains(CFG_GLOBAL_HANDLER_BUDGET))
+                global_query_.budgets.emplace(
+                    id, chrono::milliseconds(settings->value(CFG_GLOBAL_HANDLER_BUDGET).toUInt()));
 
+            invalidateEmptyQueryResults();
             emit globalQueryHandlerAdded(h);
         }
 
@@ -87,6 +157,10 @@ QueryEngine::QueryEngine(ExtensionRegistry &registry)
     {
         const auto id = e->id();
 
+        // Retired queries may still reference the handler. Await them before it is deleted.
+        discardSpeculations();
+        awaitRetiredQueries();
+
         if (const auto it = trigger_handlers_.find(id); it != trigger_handlers_.end())
         {
             auto h = it->second.handler;
@@ -100,6 +174,18 @@ QueryEngine::QueryEngine(ExtensionRegistry &registry)
             auto h = it->second;
             global_handlers_.erase(it);
             global_query_.handlers.erase(id);
+            global_query_.budgets.erase(id);
+            global_query_.statistics.erase(id);
+            global_query_.cache.remove(id);  // Items may be owned by the plugin
+
+            // A running rebuild may call the handler and its results may hold items of it.
+            // Cancel it and await it. The outdated generation drops its results.
+            ++empty_query_generation_;
+            global_query_.empty_query_results.reset();
+            empty_query_token_.cancel();
+            awaitEmptyQueryRebuild();
+            rebuildEmptyQueryResults();
+
             emit globalQueryHandlerRemoved(h);
         }
 
@@ -112,15 +198,35 @@ QueryEngine::QueryEngine(ExtensionRegistry &registry)
     });
 }
 
+QueryEngine::~QueryEngine()
+{
+    // The handlers may be gone soon. Do not rebuild when the running rebuild finished.
+    disconnect(&empty_query_watcher_, nullptr, this, nullptr);
+    empty_query_token_.cancel();
+    awaitEmptyQueryRebuild();
+}
+
+void QueryEngine::awaitEmptyQueryRebuild()
+{
+    if (!empty_query_watcher_.isRunning())
+        return;
+
+    DEBG << "Awaiting the empty query rebuild";
+    QEventLoop loop;
+    connect(&empty_query_watcher_, &QFutureWatcher<GlobalQuery::EmptyQueryResults>::finished,
+            &loop, &QEventLoop::quit);
+    loop.exec();
+}
+
 void QueryEngine::setMemoryDecay(double v)
 {
     if (usage_scoring_.memory_decay != v)
     {
         DEBG << "memoryDecay set to" << v;
         app().settings()->setValue(CFG_MEMORY_DECAY, v);
-        usage_scoring_ = UsageScoring(usage_scoring_.prioritize_perfect_match, v,
-                                      make_shared<unordered_map<ItemKey, double>>
-                                      (UsageDatabase::instance().itemUsageScores(v)));
+        setUsageScoring(UsageScoring(usage_scoring_.prioritize_perfect_match, v,
+                                     make_shared<unordered_map<ItemKey, double>>
+                                     (UsageDatabase::instance().itemUsageScores(v))));
     }
 }
 
@@ -130,7 +236,7 @@ void QueryEngine::setPrioritizePerfectMatch(bool v)
     {
         DEBG << "prioritizePerfectMatch set to" << v;
         app().settings()->setValue(CFG_PRIO_PERFECT, v);
-        usage_scoring_ = UsageScoring(v, usage_scoring_.memory_decay, usage_scoring_.usage_scores);
+        setUsageScoring(UsageScoring(v, usage_scoring_.memory_decay, usage_scoring_.usage_scores));
     }
 }
 
@@ -141,11 +247,49 @@ void QueryEngine::storeItemActivation(const QString &query, const QString &exten
 
     auto scores = UsageDatabase::instance().itemUsageScores(usage_scoring_.memory_decay);
 
-    usage_scoring_ = UsageScoring(
+    setUsageScoring(UsageScoring(
         usage_scoring_.prioritize_perfect_match,
         usage_scoring_.memory_decay,
         make_shared<unordered_map<ItemKey, double>>(::move(scores))
-    );
+    ));
+}
+
+void QueryEngine::setUsageScoring(UsageScoring usage_scoring)
+{
+    usage_scoring_ = ::move(usage_scoring);
+    global_query_.cache.clear();  // Cached results are usage scored
+    invalidateEmptyQueryResults();
+}
+
+void QueryEngine::invalidateEmptyQueryResults()
+{
+    ++empty_query_generation_;
+    global_query_.empty_query_results.reset();
+    rebuildEmptyQueryResults();
+}
+
+void QueryEngine::rebuildEmptyQueryResults()
+{
+    if (empty_query_watcher_.isRunning())
+        return;  // Rebuilt again when finished
+
+    // FIXME ranges::to
+    auto v = global_query_.handlers | views::values;
+    vector<GlobalQueryHandler*> handlers{begin(v), end(v)};
+
+    empty_query_token_ = CancellationToken();
+
+    // Snapshot the state, the task must not touch the engine
+    empty_query_watcher_.setFuture(runInBackground(
+        [handlers = ::move(handlers),
+         usage_scoring = usage_scoring_,
+         generation = empty_query_generation_,
+         token = empty_query_token_]
+        {
+            auto empty_query_results = GlobalQuery::rankEmptyQuery(handlers, usage_scoring, token);
+            empty_query_results.generation = generation;
+            return empty_query_results;
+        }));
 }
 
 UsageScoring QueryEngine::usageScoring() const
@@ -168,13 +312,40 @@ unique_ptr<detail::Query> QueryEngine::query(QString string)
         trigger = it->first;
         handler = it->second;
         string = string.mid(trigger.size());
+
+        // The real handler replaces the placeholder when loaded, which resets the session
+        if (const auto d = deferred_handlers_.find(handler->id());
+            d != deferred_handlers_.end() && d->second.get() == handler)
+            emit activationRequested(handler->id());
     }
     else
+    {
         handler = &global_query_;
 
+        // E.g. an index changed. Run this query live and rebuild in the background.
+        if (string.isEmpty() && global_query_.emptyQueryResultsOutdated())
+            invalidateEmptyQueryResults();
+    }
+
     auto query = unique_ptr<detail::Query>(
         new detail::Query(usage_scoring_, ::move(fallbacks), *handler, trigger, string));
 
+    // Results of handlers without generations can not be checked. Refresh them once served.
+    if (handler == &global_query_ && string.isEmpty() && global_query_.emptyQueryResultsVolatile())
+    {
+        ++empty_query_generation_;
+        rebuildEmptyQueryResults();
+    }
+
+    // Remember global queries leading to activations for speculative execution
+    if (handler == &global_query_ && !string.isEmpty())
+        connect(&query->matches(), &QueryResults::resultActivated, this, [this, string] {
+            recent_queries_.removeAll(string);
+            recent_queries_.prepend(string);
+            if (recent_queries_.size() > speculation_depth)
+                recent_queries_.removeLast();
+        });
+
     connect(&query->matches(), &QueryResults::resultActivated,
             this, &QueryEngine::storeItemActivation);
 
@@ -184,6 +355,104 @@ unique_ptr<detail::Query> QueryEngine::query(QString string)
     return query;
 }
 
+void QueryEngine::retire(unique_ptr<detail::Query> query)
+{
+    query->cancel();
+
+    if (!query->execution().isActive())
+        return;
+
+    // Queued, the query must not be deleted in a signal emitted by its own execution.
+    auto *q = query.get();
+    connect(&q->execution(), &QueryExecution::activeChanged, this, [this, q](bool active) {
+        if (!active)
+            erase_if(retired_queries_, [q](const auto &r){ return r.get() == q; });
+    }, Qt::QueuedConnection);
+
+    retired_queries_.emplace_back(::move(query));
+}
+
+void QueryEngine::awaitRetiredQueries()
+{
+    // Executions already got cancelled. Do not block, the event loop keeps running meanwhile.
+    set<const detail::Query*> awaited;
+    QEventLoop loop;
+    for (const auto &query : retired_queries_)
+        if (query->execution().isActive())  // Else about to be deleted
+        {
+            awaited.insert(query.get());
+            connect(&query->execution(), &QueryExecution::activeChanged, &loop,
+                    [&, q = query.get()](bool active) {
+                        if (!active && awaited.erase(q) && awaited.empty())
+                            loop.quit();
+                    }, Qt::QueuedConnection);
+        }
+
+    if (!awaited.empty())
+    {
+        DEBG << "Awaiting" << awaited.size() << "retired queries";
+        loop.exec();
+    }
+}
+
+void QueryEngine::speculate(const QString &last_input)
+{
+    discardSpeculations();
+
+    if (!speculative_execution_)
+        return;
+
+    // Triggered handlers may have side effects, e.g. web requests. Global queries only.
+    const auto is_triggered = [this](const QString &s) {
+        return ranges::any_of(active_triggers_ | views::keys,
+                              [&](const auto &t){ return s.startsWith(t); });
+    };
+
+    QStringList strings{last_input, QString()};
+    strings << recent_queries_;
+    strings.removeDuplicates();
+
+    for (const auto &string : strings)
+        if (!is_triggered(string))
+            speculative_queries_.emplace(string, query(string));
+
+    DEBG << "Speculative queries:" << strings;
+
+    speculation_timeout_.start();
+}
+
+unique_ptr<detail::Query> QueryEngine::adoptSpeculation(const QString &string)
+{
+    if (auto node = speculative_queries_.extract(string); !node.empty())
+    {
+        DEBG << "Adopting speculative query" << string;
+        return ::move(node.mapped());
+    }
+    return {};
+}
+
+void QueryEngine::discardSpeculations()
+{
+    speculation_timeout_.stop();
+    for (auto &[string, query] : speculative_queries_)
+        retire(::move(query));
+    speculative_queries_.clear();
+}
+
+bool QueryEngine::speculativeExecution() const { return speculative_execution_; }
+
+void QueryEngine::setSpeculativeExecution(bool v)
+{
+    if (speculative_execution_ != v)
+    {
+        DEBG << "speculativeExecution set to" << v;
+        app().settings()->setValue(CFG_SPECULATIVE_EXECUTION, v);
+        speculative_execution_ = v;
+        if (!v)
+            discardSpeculations();
+    }
+}
+
 //
 // Trigger handlers
 //
@@ -199,6 +468,41 @@ map<QString, QueryHandler*> QueryEngine::triggerHandlers()
 const map<QString, QueryHandler *> &QueryEngine::activeTriggerHandlers() const
 { return active_triggers_; }
 
+void QueryEngine::addDeferredTriggers(const QString &id, const QString &name,
+                                      const QString &description, QStringList triggers)
+{
+    if (const auto t = app().settings()->value(QString("%1/%2").arg(id, CFG_TRIGGER));
+        t.isValid() && !triggers.isEmpty())
+        triggers[0] = t.toString();
+
+    auto &h = deferred_handlers_[id];
+    if (!h)
+        h = make_unique<DeferredQueryHandler>();
+    h->id_ = id;
+    h->name_ = name;
+    h->description_ = description;
+    h->triggers = ::move(triggers);
+    updateActiveTriggers();
+}
+
+void QueryEngine::removeDeferredTriggers(const QString &id)
+{
+    if (auto node = deferred_handlers_.extract(id))
+    {
+        auto h = shared_ptr<DeferredQueryHandler>(::move(node.mapped()));
+        updateActiveTriggers();
+        emit queryHandlerRemoved(h.get());
+
+        // Queued after the session reset. Retired queries may still reference the placeholder.
+        // Their executions keep it alive, the connections are destroyed with them.
+        QMetaObject::invokeMethod(this, [this, h]{
+            for (const auto &query : retired_queries_)
+                if (&query->handler() == h.get())
+                    connect(&query->execution(), &QueryExecution::activeChanged, this, [h]{});
+        }, Qt::QueuedConnection);
+    }
+}
+
 void QueryEngine::updateActiveTriggers()
 {
     active_triggers_.clear();
@@ -206,6 +510,11 @@ void QueryEngine::updateActiveTriggers()
         if (const auto&[it, success] = active_triggers_.emplace(h.trigger, h.handler); !success)
             WARN << QString("Trigger '%1' of '%2' already registered for '%3'.")
                         .arg(h.trigger, id, it->second->id());
+    for (const auto&[id, h] : deferred_handlers_)
+        for (const auto &t : h->triggers)
+            if (const auto&[it, success] = active_triggers_.emplace(t, h.get()); !success)
+                WARN << QString("Trigger '%1' of '%2' already registered for '%3'.")
+                            .arg(t, id, it->second->id());
     emit activeTriggersChanged();
 }
 
@@ -277,6 +586,78 @@ void QueryEngine::setEnabled(const QString &id, bool e)
             global_query_.handlers.emplace(id, h);
         else
             global_query_.handlers.erase(id);
+        invalidateEmptyQueryResults();
+    }
+}
+
+uint QueryEngine::budget(const QString &id) const
+{ return global_query_.budget(id).count(); }
+
+void QueryEngine::setBudget(const QString &id, uint ms)
+{
+    if (!global_handlers_.contains(id) || budget(id) == ms)
+        return;
+
+    if (ms == defaultBudget())
+    {
+        global_query_.budgets.erase(id);
+        app().settings()->remove(QString("%1/%2").arg(id, CFG_GLOBAL_HANDLER_BUDGET));
+    }
+    else
+    {
+        global_query_.budgets.insert_or_assign(id, chrono::milliseconds(ms));
+        app().settings()->setValue(QString("%1/%2").arg(id, CFG_GLOBAL_HANDLER_BUDGET), ms);
+    }
+}
+
+uint QueryEngine::defaultBudget() const { return global_query_.default_budget.count(); }
+
+void QueryEngine::setDefaultBudget(uint ms)
+{
+    if (defaultBudget() != ms)
+    {
+        DEBG << "globalHandlerBudget set to" << ms;
+        app().settings()->setValue(CFG_DEFAULT_BUDGET, ms);
+        global_query_.default_budget = chrono::milliseconds(ms);
+    }
+}
+
+bool QueryEngine::dropOverrunResults() const { return global_query_.drop_overrun_results; }
+
+void QueryEngine::setDropOverrunResults(bool v)
+{
+    if (dropOverrunResults() != v)
+    {
+        DEBG << "dropOverrunResults set to" << v;
+        app().settings()->setValue(CFG_DROP_OVERRUNS, v);
+        global_query_.drop_overrun_results = v;
+    }
+}
+
+uint QueryEngine::resultCacheSize() const
+{ return global_query_.cache.capacity() / 1024 / 1024; }
+
+void QueryEngine::setResultCacheSize(uint mib)
+{
+    if (resultCacheSize() != mib)
+    {
+        DEBG << "resultCacheSize set to" << mib;
+        app().settings()->setValue(CFG_RESULT_CACHE_SIZE, mib);
+        global_query_.cache.setCapacity(mib * 1024 * 1024);
+    }
+}
+
+const QueryMetrics &QueryEngine::queryMetrics() const { return global_query_.metrics; }
+
+bool QueryEngine::deduplicate() const { return global_query_.deduplicate; }
+
+void QueryEngine::setDeduplicate(bool v)
+{
+    if (deduplicate() != v)
+    {
+        DEBG << "deduplicateResults set to" << v;
+        app().settings()->setValue(CFG_DEDUPLICATE, v);
+        global_query_.deduplicate = v;
     }
 }
 
@@ -1,11 +1,16 @@
 // Copyright (c) 2023-2025 Manuel Schneider
 
 #pragma once
+#include "cancellationtoken.h"
 #include "globalquery.h"
 #include "usagescoring.h"
+#include <QFutureWatcher>
 #include <QObject>
+#include <QStringList>
+#include <QTimer>
 #include <map>
 #include <memory>
+#include <vector>
 namespace albert {
 class ExtensionRegistry;
 class FallbackHandler;
@@ -15,6 +20,7 @@ class UsageScoring;
 class QueryResult;
 namespace detail { class Query; }
 }
+class DeferredQueryHandler;
 
 class QueryEngine : public QObject
 {
@@ -23,9 +29,27 @@ class QueryEngine : public QObject
 public:
 
     QueryEngine(albert::ExtensionRegistry&);
+    ~QueryEngine() override;
 
     std::unique_ptr<albert::detail::Query> query(QString query);
 
+    /// Cancels the query and deletes it as soon as its execution is inactive.
+    /// Avoids blocking the caller on long running handlers.
+    void retire(std::unique_ptr<albert::detail::Query> query);
+
+    /// Starts global queries for the last input, the empty input and recent queries, such that
+    /// results are ready when the frontend shows up. Supersedes previous speculations.
+    void speculate(const QString &last_input);
+
+    /// Returns the speculative query for _query_ if any; else nullptr.
+    std::unique_ptr<albert::detail::Query> adoptSpeculation(const QString &query);
+
+    /// Retires all speculative queries.
+    void discardSpeculations();
+
+    bool speculativeExecution() const;
+    void setSpeculativeExecution(bool);
+
     albert::UsageScoring usageScoring() const;
     void setMemoryDecay(double);
     void setPrioritizePerfectMatch(bool);
@@ -36,6 +60,18 @@ public:
     std::map<QString, albert::GlobalQueryHandler*> globalHandlers();
     std::map<QString, albert::FallbackHandler*> fallbackHandlers();
 
+    ///
+    /// Registers placeholder _triggers_ for the plugin _id_ whose loading has been deferred.
+    ///
+    /// Queries using one of the triggers emit \ref activationRequested and yield no results.
+    /// The user configured trigger of the handler having the plugin id replaces the first one.
+    ///
+    void addDeferredTriggers(const QString &id, const QString &name,
+                             const QString &description, QStringList triggers);
+
+    /// Removes the placeholder triggers of the plugin _id_ and emits \ref queryHandlerRemoved.
+    void removeDeferredTriggers(const QString &id);
+
     // Trigger handlers
     const std::map<QString, albert::QueryHandler*> &activeTriggerHandlers() const;
     QString trigger(const QString&) const;
@@ -46,6 +82,17 @@ public:
     // Global handlers
     bool isEnabled(const QString&) const;
     void setEnabled(const QString&, bool = true);
+    uint budget(const QString&) const;  // ms, 0 is unlimited
+    void setBudget(const QString&, uint);
+    uint defaultBudget() const;
+    void setDefaultBudget(uint);
+    bool dropOverrunResults() const;
+    void setDropOverrunResults(bool);
+    bool deduplicate() const;
+    void setDeduplicate(bool);
+    uint resultCacheSize() const;  // MiB, 0 disables caching
+    void setResultCacheSize(uint);
+    const QueryMetrics &queryMetrics() const;
 
     // Fallback handlers
     const std::map<std::pair<QString, QString>, int> &fallbackOrder() const;
@@ -54,8 +101,13 @@ public:
 private:
 
     void updateActiveTriggers();
+    void awaitRetiredQueries();  // Runs a local event loop until they are inactive
+    void awaitEmptyQueryRebuild();  // Runs a local event loop until it finished
     void saveFallbackOrder() const;
     void loadFallbackOrder();
+    void setUsageScoring(albert::UsageScoring);
+    void invalidateEmptyQueryResults();
+    void rebuildEmptyQueryResults();
     std::vector<albert::QueryResult> fallbacks(const QString &query);
 
     albert::ExtensionRegistry &registry_;
@@ -67,15 +119,26 @@ private:
     };
     std::map<QString, QueryHandler> trigger_handlers_;
     std::map<QString, albert::QueryHandler*> active_triggers_;
+    std::map<QString, std::unique_ptr<DeferredQueryHandler>> deferred_handlers_;  // Retired queries keep removed ones alive
 
     GlobalQuery global_query_;
     std::map<QString, albert::GlobalQueryHandler*> global_handlers_;
+    QFutureWatcher<GlobalQuery::EmptyQueryResults> empty_query_watcher_;
+    uint empty_query_generation_ = 0;
+    albert::CancellationToken empty_query_token_;  // Of the running rebuild
 
     std::map<QString, albert::FallbackHandler*> fallback_handlers_;
     std::map<std::pair<QString, QString>, int> fallback_order_;
 
     albert::UsageScoring usage_scoring_;
 
+    std::vector<std::unique_ptr<albert::detail::Query>> retired_queries_;
+
+    bool speculative_execution_;
+    QStringList recent_queries_;  // Most recent first
+    std::map<QString, std::unique_ptr<albert::detail::Query>> speculative_queries_;
+    QTimer speculation_timeout_;
+
 signals:
 
     void queryHandlerAdded(albert::QueryHandler*);
@@ -89,4 +152,7 @@ signals:
 
     void activeTriggersChanged();
 
+    /// Emitted while building a query. Receivers changing triggers must connect queued.
+    void activationRequested(const QString &plugin_id);
+
 };
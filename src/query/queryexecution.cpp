@@ -1,15 +1,36 @@
 // Copyright (c) 2022-2025 Manuel Schneider
 
 #include "queryexecution.h"
+#include <algorithm>
 using namespace albert;
+using namespace std;
 
 namespace {
 uint query_execution_count = 0;
+static const uint default_viewport_size = 10;
+static const uint max_batch_growth = 6;  // Doublings
+static const double scroll_lookahead = 0.25;  // Seconds
 }
 
 QueryExecution::QueryExecution(QueryContext &ctx)
     : id(query_execution_count++)
     , context(ctx)
     , results(ctx)
+    , viewport_size_(0)
+    , scroll_velocity_(0.)
+    , batch_count_(0)
 {}
 
+void QueryExecution::setViewportSize(uint rows) { viewport_size_ = rows; }
+
+void QueryExecution::setScrollVelocity(double rows_per_second)
+{ scroll_velocity_ = max(0., rows_per_second); }
+
+uint QueryExecution::nextBatchSize()
+{
+    const uint viewport = viewport_size_ ? viewport_size_.load() : default_viewport_size;
+    const uint growth = min(batch_count_++, max_batch_growth);
+    const uint scrolled = static_cast<uint>(scroll_velocity_ * scroll_lookahead);
+    return max(viewport << growth, scrolled);
+}
+
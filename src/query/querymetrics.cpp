@@ -0,0 +1,65 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "querymetrics.h"
+#include <algorithm>
+#include <ranges>
+#include <vector>
+using namespace Qt::StringLiterals;
+using namespace std;
+
+void MetricSeries::add(uint sample) { samples_[count_++ % samples_.size()] = sample; }
+
+uint MetricSeries::size() const { return min<uint>(count_, samples_.size()); }
+
+MetricSeries::Percentiles MetricSeries::percentiles() const
+{
+    const auto n = size();
+    if (n == 0)
+        return {};
+
+    vector<uint> sorted(samples_.begin(), samples_.begin() + n);
+    ranges::sort(sorted);
+    const auto at = [&](double p) { return sorted[min<size_t>(n - 1, (size_t)(p * n))]; };
+    return {at(.50), at(.95), at(.99)};
+}
+
+void QueryMetrics::addHandlerSample(const QString &id, uint handling_us, uint scoring_us, uint items)
+{
+    auto &h = handlers[id];
+    h.handling.add(handling_us);
+    h.scoring.add(scoring_us);
+    h.items.add(items);
+}
+
+QStringList QueryMetrics::report() const
+{
+    static const auto fmt = [](const MetricSeries &s) {
+        const auto p = s.percentiles();
+        return u"%1 %2 %3"_s.arg(p.p50, 6).arg(p.p95, 6).arg(p.p99, 6);
+    };
+
+    QStringList sl;
+    sl << u"%1 %2 samples (p50 p95 p99)"_s.arg(u"First chunk ms"_s, -32).arg(fmt(first_chunk))
+              .arg(first_chunk.size());
+    sl << u"%1 %2 samples (p50 p95 p99)"_s.arg(u"Fetch sort µs"_s, -32).arg(fmt(fetch))
+              .arg(fetch.size());
+
+    vector<pair<const QString*, const HandlerMetrics*>> sorted;
+    for (const auto &[id, metrics] : handlers)
+        sorted.emplace_back(&id, &metrics);
+    ranges::sort(sorted, greater{}, [](const auto &p){ return p.second->handling.percentiles().p95; });
+
+    sl << u"%1 %2 %3 %4 Samples"_s
+              .arg(u"Handler (p50 p95 p99)"_s, -32)
+              .arg(u"Handling µs"_s, -20)
+              .arg(u"Scoring µs"_s, -20)
+              .arg(u"Items"_s, -20);
+    for (const auto &[id, metrics] : sorted)
+        sl << u"%1 %2 %3 %4 %5"_s
+                  .arg(*id, -32)
+                  .arg(fmt(metrics->handling), -20)
+                  .arg(fmt(metrics->scoring), -20)
+                  .arg(fmt(metrics->items), -20)
+                  .arg(metrics->handling.size());
+    return sl;
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <array>
+#include <map>
+
+///
+/// Bounded series of samples retaining the most recent ones.
+///
+class MetricSeries
+{
+public:
+
+    struct Percentiles
+    {
+        uint p50 = 0;
+        uint p95 = 0;
+        uint p99 = 0;
+    };
+
+    /// The number of samples retained.
+    static constexpr uint capacity = 256;
+
+    void add(uint sample);
+
+    /// Returns the number of retained samples.
+    uint size() const;
+
+    /// Returns the percentiles of the retained samples.
+    Percentiles percentiles() const;
+
+private:
+
+    std::array<uint, capacity> samples_{};
+    uint count_ = 0;  // Total, the ring index is count_ % samples_.size()
+
+};
+
+///
+/// Performance metrics of global queries.
+///
+/// Not thread-safe. Samples are recorded in the main thread when query executions finish.
+///
+class QueryMetrics
+{
+public:
+
+    struct HandlerMetrics
+    {
+        MetricSeries handling;  // µs
+        MetricSeries scoring;  // µs
+        MetricSeries items;
+    };
+
+    std::map<QString, HandlerMetrics> handlers;  // By handler id
+    MetricSeries first_chunk;  // ms from query start to the first results
+    MetricSeries fetch;  // µs to sort a chunk of results
+
+    void addHandlerSample(const QString &id, uint handling_us, uint scoring_us, uint items);
+
+    /// Returns a human readable table of the percentiles, slowest handlers first.
+    QStringList report() const;
+};
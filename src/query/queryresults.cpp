@@ -1,13 +1,27 @@
 // Copyright (c) 2023-2025 Manuel Schneider
 
 #include "extension.h"
+#include "icon.h"
+#include "iconloader.h"
 #include "logging.h"
 #include "messagebox.h"
 #include "queryresults.h"
+#include <QThread>
+#include <QTimer>
+#include <QUrl>
+#include <algorithm>
 using namespace albert;
 using namespace std;
 
-QueryResults::QueryResults(const QueryContext &ctx) : context(ctx){}
+namespace
+{
+static const auto deferred_flush_interval = chrono::milliseconds(250);
+}
+
+QueryResults::QueryResults(const QueryContext &ctx) : context(ctx)
+{
+    connect(&IconLoader::instance(), &IconLoader::loaded, this, &QueryResults::onIconsLoaded);
+}
 
 QueryResults::~QueryResults()
 {
@@ -62,9 +76,117 @@ bool QueryResults::activate(uint item_idx, uint action_idx)
 
 void QueryResults::onItemChanged(const Item *item)
 {
-    // O(n) but since the results are populated lazy this should be okay.
-    if (auto it = find_if(results.begin(), results.end(),
-                          [=](const auto &ri){ return ri.item.get() == item; });
-        it != results.end())
-        emit resultChanged(distance(results.begin(), it));
+    // Items may change in any thread. The pointer is used as key only.
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, [this, item]{ onItemChanged(item); }, Qt::QueuedConnection);
+        return;
+    }
+
+    changed_items.insert(item);
+    icon_urls.erase(item);  // The icon may have changed
+
+    if (!flush_scheduled)
+    {
+        flush_scheduled = true;
+        QMetaObject::invokeMethod(this, &QueryResults::flushChanges, Qt::QueuedConnection);
+    }
+}
+
+void QueryResults::onIconsLoaded(const QStringList &paths)
+{
+    // Icons paint placeholders until their images are decoded. Repaint the visible results using
+    // the decoded images. Others paint them when scrolled into view.
+    int first = 0;
+    int last = (int)results.size() - 1;
+    if (visible_first <= visible_last)
+    {
+        first = max(first, visible_first);
+        last = min(last, visible_last);
+    }
+
+    for (int row = first; row <= last; ++row)
+    {
+        const auto &item = results[row].item;
+        auto it = icon_urls.find(item.get());
+        if (it == icon_urls.end())
+        {
+            // Wrapping icons percent encode the URLs of their sources
+            auto icon = item->icon();
+            it = icon_urls.emplace(item.get(),
+                                   icon ? QUrl::fromPercentEncoding(icon->toUrl().toUtf8())
+                                        : QString{}).first;
+        }
+
+        if (ranges::any_of(paths, [&](const auto &path){ return it->second.contains(path); }))
+            changed_items.insert(item.get());
+    }
+
+    if (!changed_items.empty() && !flush_scheduled)
+    {
+        flush_scheduled = true;
+        QMetaObject::invokeMethod(this, &QueryResults::flushChanges, Qt::QueuedConnection);
+    }
+}
+
+void QueryResults::setVisibleRange(int first, int last)
+{
+    visible_first = first;
+    visible_last = last;
+
+    // Changes of results scrolled into view are due now
+    if (!deferred_items.empty())
+        flushDeferredChanges();
+}
+
+void QueryResults::flushDeferredChanges()
+{
+    deferred_flush_scheduled = false;
+    changed_items.merge(deferred_items);
+    deferred_items.clear();  // Merge leaves duplicates
+    emitChanges(false);
+}
+
+void QueryResults::flushChanges()
+{
+    flush_scheduled = false;
+    emitChanges(visible_first <= visible_last);
+}
+
+void QueryResults::emitChanges(bool defer_invisible)
+{
+    vector<uint> changed_rows;
+    for (const auto *item : changed_items)
+        for (auto [it, end] = rows.equal_range(item); it != end; ++it)
+        {
+            if (defer_invisible
+                && ((int)it->second < visible_first || visible_last < (int)it->second))
+                deferred_items.insert(item);
+            else
+                changed_rows.emplace_back(it->second);
+        }
+    changed_items.clear();
+
+    if (!deferred_items.empty() && !deferred_flush_scheduled)
+    {
+        deferred_flush_scheduled = true;
+        QTimer::singleShot(deferred_flush_interval, this, &QueryResults::flushDeferredChanges);
+    }
+
+    if (changed_rows.empty())
+        return;
+
+    ranges::sort(changed_rows);
+
+    emit resultsChanged(changed_rows.front(), changed_rows.back());
+
+    for (auto row : changed_rows)
+        emit resultChanged(row);
+}
+
+void QueryResults::updateRows(uint first)
+{
+    erase_if(rows, [=](const auto &entry){ return entry.second >= first; });
+    for (auto row = first; row < results.size(); ++row)
+        rows.emplace(results[row].item.get(), row);
 }
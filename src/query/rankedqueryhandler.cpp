@@ -9,6 +9,8 @@ using namespace std;
 
 RankedQueryHandler::~RankedQueryHandler() {}
 
+uint RankedQueryHandler::readAhead() const { return 0; }
+
 ItemGenerator RankedQueryHandler::items(QueryContext &ctx)
 {
     auto rank_items = rankItems(ctx);
@@ -22,7 +24,7 @@ ItemGenerator RankedQueryHandler::lazySort(vector<RankItem> rank_items)
     {
         // Partial sort the items incrementally in reverse order (for cheap "pop_n")
         auto reverse_view = rank_items | views::reverse;
-        auto take_view = reverse_view | views::take(10);
+        auto take_view = reverse_view | views::take(static_cast<int>(batchSize()));
         ranges::partial_sort(reverse_view, take_view.end(), greater{});
 
         // Yield chunk
@@ -0,0 +1,135 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "querypreprocessing.h"
+#include "resultcache.h"
+using namespace albert;
+using namespace std;
+
+ResultCache::ResultCache(size_t capacity) : capacity_(capacity), size_(0), epoch_(0) {}
+
+QString ResultCache::key(const QString &id, const QString &query)
+{ return id + QChar(0x1f) + preprocessQuery(query).join(QChar(0x1f)); }
+
+optional<vector<RankItem>> ResultCache::get(const QString &id, const QString &query,
+                                            uint generation)
+{
+    lock_guard lock(mutex_);
+
+    const auto it = index_.find(key(id, query));
+    if (it == index_.end())
+        return nullopt;
+
+    if (it->second->generation != generation)
+    {
+        size_ -= it->second->size;
+        entries_.erase(it->second);
+        index_.erase(it);
+        return nullopt;
+    }
+
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->results;
+}
+
+void ResultCache::put(const QString &id, const QString &query, uint generation, uint epoch,
+                      const vector<RankItem> &results)
+{
+    auto k = key(id, query);
+
+    // Rough estimate. Items are shared with the handler and not accounted.
+    const size_t entry_size = sizeof(Entry)
+                              + 2 * sizeof(QChar) * k.size()
+                              + results.size() * (sizeof(RankItem) + 2 * sizeof(void*));
+    if (entry_size > capacity_)
+        return;
+
+    lock_guard lock(mutex_);
+
+    if (epoch != epoch_)  // Stale usage scores
+        return;
+
+    if (const auto &[it, inserted] = generations_.emplace(id, generation);
+        !inserted && it->second != generation)
+    {
+        removeHandler(id);
+        generations_.emplace(id, generation);
+    }
+
+    if (const auto it = index_.find(k); it != index_.end())
+    {
+        size_ -= it->second->size;
+        entries_.erase(it->second);
+        index_.erase(it);
+    }
+
+    entries_.emplace_front(k, id, generation, results, entry_size);
+    index_.emplace(::move(k), entries_.begin());
+    size_ += entry_size;
+
+    evict();
+}
+
+void ResultCache::remove(const QString &id)
+{
+    lock_guard lock(mutex_);
+    removeHandler(id);
+}
+
+void ResultCache::removeHandler(const QString &id)
+{
+    generations_.erase(id);
+    for (auto it = entries_.begin(); it != entries_.end();)
+        if (it->handler_id == id)
+        {
+            size_ -= it->size;
+            index_.erase(it->key);
+            it = entries_.erase(it);
+        }
+        else
+            ++it;
+}
+
+void ResultCache::clear()
+{
+    lock_guard lock(mutex_);
+    index_.clear();
+    entries_.clear();
+    generations_.clear();
+    size_ = 0;
+    ++epoch_;
+}
+
+uint ResultCache::epoch() const
+{
+    lock_guard lock(mutex_);
+    return epoch_;
+}
+
+size_t ResultCache::size() const
+{
+    lock_guard lock(mutex_);
+    return size_;
+}
+
+size_t ResultCache::capacity() const
+{
+    lock_guard lock(mutex_);
+    return capacity_;
+}
+
+void ResultCache::setCapacity(size_t bytes)
+{
+    lock_guard lock(mutex_);
+    capacity_ = bytes;
+    evict();
+}
+
+void ResultCache::evict()
+{
+    while (size_ > capacity_ && !entries_.empty())
+    {
+        size_ -= entries_.back().size;
+        index_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+}
@@ -0,0 +1,79 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include "rankitem.h"
+#include <QString>
+#include <QStringList>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+///
+/// Thread-safe LRU cache of global query handler results.
+///
+/// Entries are keyed by handler id and normalized query and are valid for a single result
+/// generation of the handler. The size is bounded by an estimate of the memory used.
+///
+class ResultCache
+{
+public:
+
+    ResultCache(size_t capacity);
+
+    /// Returns the cached results of handler _id_ for _query_ if valid for _generation_.
+    std::optional<std::vector<albert::RankItem>> get(const QString &id, const QString &query,
+                                                     uint generation);
+
+    ///
+    /// Caches _results_ of handler _id_ for _query_ and _generation_.
+    ///
+    /// Entries of other generations of the handler are removed, they would keep items alive the
+    /// handler dropped already.
+    ///
+    /// Results scored before the last \ref clear() are dropped. Pass the \ref epoch() at the time
+    /// the usage scoring was taken as _epoch_.
+    ///
+    void put(const QString &id, const QString &query, uint generation, uint epoch,
+             const std::vector<albert::RankItem> &results);
+
+    /// Removes the entries of handler _id_.
+    void remove(const QString &id);
+
+    /// Removes all entries and starts a new epoch.
+    void clear();
+
+    /// Returns the number of clears, i.e. the current epoch.
+    uint epoch() const;
+
+    /// Returns the estimated memory used in bytes.
+    size_t size() const;
+
+    size_t capacity() const;
+    void setCapacity(size_t bytes);
+
+private:
+
+    struct Entry
+    {
+        QString key;
+        QString handler_id;
+        uint generation;
+        std::vector<albert::RankItem> results;
+        size_t size;
+    };
+
+    static QString key(const QString &id, const QString &query);
+    void removeHandler(const QString &id);
+    void evict();
+
+    mutable std::mutex mutex_;
+    std::list<Entry> entries_;  // Most recently used first
+    std::unordered_map<QString, std::list<Entry>::iterator> index_;
+    std::unordered_map<QString, uint> generations_;  // Of the entries per handler
+    size_t capacity_;
+    size_t size_;
+    uint epoch_;
+
+};
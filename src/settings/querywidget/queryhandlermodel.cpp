@@ -5,14 +5,15 @@
 #include "queryhandlermodel.h"
 #include <QCoreApplication>
 #include <QHeaderView>
+#include <QLocale>
 #include <QMessageBox>
 #include <set>
 using namespace albert;
 using namespace std;
 
 namespace {
-enum class Column { Name, Trigger, Global, Fuzzy };
-static int column_count = 4;
+enum class Column { Name, Trigger, Global, Fuzzy, Budget, Latency };
+static int column_count = 6;
 }
 
 
@@ -111,6 +112,42 @@ QVariant QueryHandlerModel::data(const QModelIndex &idx, int role) const
         }
     }
 
+    else if (idx.column() == (int) Column::Budget)
+    {
+        if (auto *gh = dynamic_cast<const GlobalQueryHandler*>(h); gh)
+        {
+            if (role == Qt::DisplayRole || role == Qt::EditRole)
+                return engine.budget(gh->id());
+
+            else if (role == Qt::ToolTipRole)
+                return tr("Time in ms the global query waits for this handler. 0 is unlimited.");
+        }
+    }
+
+    else if (idx.column() == (int) Column::Latency)
+    {
+        const auto &handlers = engine.queryMetrics().handlers;
+        if (const auto it = handlers.find(h->id()); it != handlers.end())
+        {
+            const auto handling = it->second.handling.percentiles();
+
+            if (role == Qt::DisplayRole)
+                return QLocale().toString(handling.p95 / 1000., 'f', 1);
+
+            else if (role == Qt::ToolTipRole)
+            {
+                const auto scoring = it->second.scoring.percentiles();
+                const auto items = it->second.items.percentiles();
+                return tr("Handling: %1/%2/%3 µs\nScoring: %4/%5/%6 µs\nItems: %7/%8/%9\n"
+                          "p50/p95/p99 of the last %10 global queries")
+                    .arg(handling.p50).arg(handling.p95).arg(handling.p99)
+                    .arg(scoring.p50).arg(scoring.p95).arg(scoring.p99)
+                    .arg(items.p50).arg(items.p95).arg(items.p99)
+                    .arg(it->second.handling.size());
+            }
+        }
+    }
+
     return {};
 }
 
@@ -147,6 +184,15 @@ bool QueryHandlerModel::setData(const QModelIndex &idx, const QVariant &value, i
         }
     }
 
+    else if (idx.column() == (int) Column::Budget)
+    {
+        if (auto *gh = dynamic_cast<GlobalQueryHandler*>(h); gh && role == Qt::EditRole)
+        {
+            engine.setBudget(gh->id(), value.toUInt());
+            return true;
+        }
+    }
+
     else if (idx.column() == (int) Column::Fuzzy)
     {
         if (role == Qt::CheckStateRole) {
@@ -166,6 +212,8 @@ QVariant QueryHandlerModel::headerData(int section, Qt::Orientation orientation,
         case Column::Trigger: return tr("Trigger");
         case Column::Global: return tr("G", "short Global");
         case Column::Fuzzy: return tr("F", "short Fuzzy");
+        case Column::Budget: return tr("Budget");
+        case Column::Latency: return tr("p95");
         }
     else if (role == Qt::ToolTipRole)
         switch ((Column) section) {
@@ -173,6 +221,8 @@ QVariant QueryHandlerModel::headerData(int section, Qt::Orientation orientation,
         case Column::Trigger: return tr("The trigger of the handler. Spaces are visualized by •.");
         case Column::Global: return tr("Global query handling.");
         case Column::Fuzzy: return tr("Fuzzy matching.");
+        case Column::Budget: return tr("Time in ms the global query waits for the handler. 0 is unlimited.");
+        case Column::Latency: return tr("95th percentile of the global query handling duration in ms.");
         }
     return {};
 }
@@ -190,6 +240,10 @@ Qt::ItemFlags QueryHandlerModel::flags(const QModelIndex &idx) const
         return dynamic_cast<GlobalQueryHandler*>(h) ? Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable : Qt::NoItemFlags;
     case Column::Fuzzy:
         return h->supportsFuzzyMatching() ? Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable : Qt::NoItemFlags;
+    case Column::Budget:
+        return dynamic_cast<GlobalQueryHandler*>(h) ? Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsEditable : Qt::NoItemFlags;
+    case Column::Latency:
+        return Qt::ItemIsEnabled;
     }
     return {};
 }
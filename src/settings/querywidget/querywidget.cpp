@@ -23,6 +23,21 @@ QueryWidget::QueryWidget(QueryEngine &query_engine) : query_engine_(query_engine
     connect(ui.checkBox_prioritizePerfectMatch, &QCheckBox::toggled, this,
             [this](bool val){ query_engine_.setPrioritizePerfectMatch(val); });
 
+    ui.spinBox_budget->setValue((int)query_engine_.defaultBudget());
+
+    connect(ui.spinBox_budget, &QSpinBox::valueChanged,
+            this, [this](int value) { query_engine_.setDefaultBudget((uint)value); });
+
+    ui.checkBox_dropOverrunResults->setChecked(query_engine_.dropOverrunResults());
+
+    connect(ui.checkBox_dropOverrunResults, &QCheckBox::toggled, this,
+            [this](bool val){ query_engine_.setDropOverrunResults(val); });
+
+    ui.checkBox_speculativeExecution->setChecked(query_engine_.speculativeExecution());
+
+    connect(ui.checkBox_speculativeExecution, &QCheckBox::toggled, this,
+            [this](bool val){ query_engine_.setSpeculativeExecution(val); });
+
     ui.tableView_queryHandlers->setModel(new QueryHandlerModel(query_engine_, this)); // Takes ownership
     ui.tableView_fallbackOrder->setModel(fallbacks_model_ = new FallbacksModel(query_engine_, this)); // Takes ownership
 
@@ -3,6 +3,8 @@
 #include "indexqueryhandler.h"
 #include "itemindex.h"
 #include "querycontext.h"
+#include "trace.h"
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
@@ -14,6 +16,7 @@ class IndexQueryHandler::Private
 public:
     unique_ptr<ItemIndex> index;
     std::shared_mutex index_mutex;
+    atomic_uint generation = 1;
 };
 
 IndexQueryHandler::IndexQueryHandler() : d(new Private()) {}
@@ -22,16 +25,20 @@ IndexQueryHandler::~IndexQueryHandler() = default;
 
 void IndexQueryHandler::setIndexItems(vector<IndexItem> &&index_items)
 {
+    Trace::Span span("index", "setIndexItems", id());
     scoped_lock l(d->index_mutex);
     if (d->index)
         d->index->setItems(::move(index_items));
+    ++d->generation;
 }
 
+uint IndexQueryHandler::indexGeneration() const { return d->generation; }
+
 vector<RankItem> IndexQueryHandler::rankItems(QueryContext &ctx)
 {
     shared_lock l(d->index_mutex);
     if (d->index)
-        return d->index->search(ctx.query(), [&ctx] { return ctx.isValid(); });
+        return d->index->search(ctx.query(), ctx.cancellationToken());
     return {};
 }
 
@@ -44,6 +51,7 @@ void IndexQueryHandler::setFuzzyMatching(bool fuzzy)
         || d->index->config().fuzzy != fuzzy)
     {
         d->index = make_unique<ItemIndex>(MatchConfig{.fuzzy = fuzzy});
+        ++d->generation;
         d->index_mutex.unlock();
         updateIndexItems();
     }
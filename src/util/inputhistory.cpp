@@ -23,29 +23,34 @@ public:
 };
 
 
+static QString historyFilePath(const QString &path)
+{ return path.isEmpty() ? QDir(app().dataLocation()).filePath("albert.history") : path; }
+
 InputHistory::InputHistory(const QString &path):
     d(make_unique<Private>())
 {
-    if (path.isEmpty())
-        d->file_path = QDir(app().dataLocation()).filePath("albert.history");
-    else
-        d->file_path = path;
+    d->file_path = historyFilePath(path);
+    d->history = load(d->file_path);
+    resetIterator();
+}
 
-    if (QFile f(d->file_path); f.open(QIODevice::ReadOnly))
+QStringList InputHistory::load(const QString &path)
+{
+    QStringList history;
+    if (QFile f(historyFilePath(path)); f.open(QIODevice::ReadOnly))
     {
         const auto doc = QJsonDocument::fromJson(f.readAll());
 
         if (doc.isArray())
         {
             const auto a = doc.array();
-            d->history.reserve(a.size());
+            history.reserve(a.size());
             for (const auto v : a | views::reverse)
-                d->history << v.toString();
+                history << v.toString();
         }
         f.close();
     }
-
-    resetIterator();
+    return history;
 }
 
 InputHistory::~InputHistory()
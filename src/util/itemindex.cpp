@@ -104,9 +104,9 @@ public:
 
     vector<QString> ngrams_for_word(const QString &word)const;
     vector<WordMatch> getWordMatches(const QString &word,
-                                     const function<bool()> &stop_requested) const;
+                                     const CancellationToken &token) const;
     vector<StringMatch> getStringMatches(const QString &word,
-                                         const function<bool()> &stop_requested) const;
+                                         const CancellationToken &token) const;
 };
 
 vector<QString> ItemIndex::Private::ngrams_for_word(const QString &word) const
@@ -123,7 +123,7 @@ vector<QString> ItemIndex::Private::ngrams_for_word(const QString &word) const
 }
 
 vector<WordMatch> ItemIndex::Private::getWordMatches(const QString &word,
-                                                     const function<bool()> &stop_requested) const
+                                                     const CancellationToken &token) const
 {
     vector<WordMatch> matches;
     const uint word_length = word.length();
@@ -153,7 +153,7 @@ vector<WordMatch> ItemIndex::Private::getWordMatches(const QString &word,
         unordered_map<Index, uint> word_match_counts;
         for (const QString &n_gram : ngrams)
         {
-            if (!stop_requested)
+            if (token.isCancelled())
                 return {};
 
             // Get the ngram occurrences
@@ -186,7 +186,7 @@ vector<WordMatch> ItemIndex::Private::getWordMatches(const QString &word,
 
         for (const auto &[word_idx, ngram_count]: word_match_counts)
         {
-            if (!stop_requested)
+            if (token.isCancelled())
                 return {};
 
             if (ngram_count < minimum_match_count)
@@ -206,11 +206,11 @@ vector<WordMatch> ItemIndex::Private::getWordMatches(const QString &word,
 }
 
 vector<StringMatch> ItemIndex::Private::getStringMatches(const QString &word,
-                                                         const function<bool()> &stop_requested) const
+                                                         const CancellationToken &token) const
 {
     vector<StringMatch> string_matches;
 
-    for (const auto &word_match : getWordMatches(word, stop_requested))
+    for (const auto &word_match : getWordMatches(word, token))
         for (const auto &occurrence : word_match.word_index_item.occurrences)
             string_matches.emplace_back(occurrence.index, occurrence.position, word_match.match_length);
 
@@ -302,7 +302,7 @@ void ItemIndex::setItems(vector<IndexItem> &&index_items)
 }
 
 vector<albert::RankItem> ItemIndex::search(const QString &string,
-                                           const function<bool()> &stop_requested) const
+                                           const CancellationToken &token) const
 {
     vector<RankItem> result;
     const auto words = preprocessQuery(string, d->config);
@@ -322,15 +322,15 @@ vector<albert::RankItem> ItemIndex::search(const QString &string,
     else
     {
         unordered_map<Index, double> result_map;
-        vector<StringMatch> string_matches = d->getStringMatches(words[0], stop_requested);
+        vector<StringMatch> string_matches = d->getStringMatches(words[0], token);
 
         // In case of multiple words intersect. Todo: user chooses strategy
         for (int w = 1; w < words.size(); ++w)
         {
-            if (!stop_requested || string_matches.empty())
+            if (token.isCancelled() || string_matches.empty())
                 return {};
 
-            vector<StringMatch> other_string_matches = d->getStringMatches(words[w], stop_requested);
+            vector<StringMatch> other_string_matches = d->getStringMatches(words[w], token);
 
             if (other_string_matches.empty())
                 return {};
@@ -2,6 +2,7 @@
 
 #pragma once
 #include <QString>
+#include <albert/cancellationtoken.h>
 #include <albert/export.h>
 #include <albert/indexitem.h>
 #include <albert/matchconfig.h>
@@ -30,10 +31,10 @@ public:
 
     /// Search the index for a string.
     /// @param string The string to search for.
-    /// @param isValid A flag used to cancel the search.
-    /// @return A list of scored items.
+    /// @param token The cancellation token used to abort the search.
+    /// @return A list of scored items. Empty if the search has been cancelled.
     std::vector<albert::RankItem> search(const QString &string,
-                                         const std::function<bool()> &stop_requested) const;
+                                         const albert::CancellationToken &token) const;
 
 private:
 
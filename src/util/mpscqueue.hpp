@@ -0,0 +1,88 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+///
+/// Bounded lock-free multi producer single consumer queue.
+///
+/// Each slot has a sequence number telling whether it is free for the producer of position n
+/// (sequence == n) or ready for the consumer (sequence == n + 1). Producers never block, if the
+/// queue is full \ref push fails.
+///
+/// There must be at most one consumer at a time, e.g. consumers serialized by a mutex.
+///
+template<class T, std::size_t N>
+class MpscQueue
+{
+public:
+
+    MpscQueue()
+    {
+        for (std::size_t i = 0; i < slots_.size(); ++i)
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    /// Returns `false` if the queue is full. Any thread.
+    bool push(T &&value)
+    {
+        auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto &slot = slots_[pos % slots_.size()];
+            const auto seq = slot.sequence.load(std::memory_order_acquire);
+            if (const auto diff = (std::intptr_t)seq - (std::intptr_t)pos; diff == 0)
+            {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    slot.value = std::move(value);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+                return false;  // Full
+            else
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    /// Returns `false` if the queue is empty. Consumer only.
+    bool pop(T &value)
+    {
+        const auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+        auto &slot = slots_[pos % slots_.size()];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+            return false;  // Empty
+        value = std::move(slot.value);
+        slot.sequence.store(pos + slots_.size(), std::memory_order_release);
+        dequeue_pos_.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Any thread.
+    bool empty() const
+    {
+        const auto pos = dequeue_pos_.load(std::memory_order_acquire);
+        return slots_[pos % slots_.size()].sequence.load(std::memory_order_acquire) != pos + 1;
+    }
+
+    static constexpr std::size_t capacity() { return N; }
+
+private:
+
+    struct alignas(64) Slot
+    {
+        std::atomic_size_t sequence;
+        T value;
+    };
+
+    std::array<Slot, N> slots_;
+    alignas(64) std::atomic_size_t enqueue_pos_ = 0;
+    alignas(64) std::atomic_size_t dequeue_pos_ = 0;  // Written by the consumer only
+
+};
@@ -2,7 +2,13 @@
 
 #include "qiconengineadapter.h"
 #include "icon.h"
+#include "iconloader.h"
+#include <QGuiApplication>
+#include <QPalette>
+#include <QPixmapCache>
+#include <QThread>
 class QPainter;
+using namespace Qt::StringLiterals;
 using namespace std;
 
 QIconEngineAdapter::QIconEngineAdapter(unique_ptr<albert::Icon> icon) :
@@ -23,11 +29,32 @@ QPixmap QIconEngineAdapter::pixmap(const QSize &size, QIcon::Mode mode, QIcon::S
 
 QPixmap QIconEngineAdapter::scaledPixmap(const QSize &device_independent_size, QIcon::Mode, QIcon::State, qreal scale)
 {
-    return icon_->pixmap(device_independent_size, scale);
+    // QPixmapCache is not thread-safe. Icons without key can not be cached.
+    const auto icon_key = icon_->cacheKey();
+    if (icon_key.isEmpty() || QThread::currentThread() != qApp->thread())
+        return icon_->pixmap(device_independent_size, scale);
+
+    // Icons may use palette colors, e.g. the default grapheme brush
+    const auto key = u"albert:%1:%2x%3@%4:%5"_s
+                         .arg(icon_key)
+                         .arg(device_independent_size.width())
+                         .arg(device_independent_size.height())
+                         .arg(scale)
+                         .arg(QGuiApplication::palette().cacheKey());
+
+    QPixmap pm;
+    if (!QPixmapCache::find(key, &pm))
+    {
+        pm = icon_->pixmap(device_independent_size, scale);
+        QPixmapCache::insert(key, pm);
+    }
+    return pm;
 }
 
 void QIconEngineAdapter::paint(QPainter *painter, const QRect &rect, QIcon::Mode, QIcon::State)
 {
+    // QIcon users are not notified when images are decoded
+    IconLoader::BlockingScope blocking;
     icon_->paint(painter, rect);
 }
 
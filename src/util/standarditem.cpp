@@ -19,6 +19,8 @@ std::function<std::unique_ptr<Icon>()> StandardItem::iconFactory() { return icon
 
 void StandardItem::setInputActionText(QString t) { input_action_text_ = ::move(t); }
 
+void StandardItem::setIdentity(QString identity) { identity_ = ::move(identity); }
+
 void StandardItem::setActions(vector<Action> actions) { actions_ = ::move(actions); }
 
 QString StandardItem::id() const { return id_; }
@@ -38,3 +40,5 @@ std::unique_ptr<Icon> StandardItem::icon() const
 QString StandardItem::inputActionText() const { return input_action_text_.isNull() ? text_ : input_action_text_; }
 
 vector<Action> StandardItem::actions() const { return actions_; }
+
+QString StandardItem::identity() const { return identity_; }
@@ -0,0 +1,23 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "threadpool.h"
+#include <QThread>
+#include <algorithm>
+using namespace std;
+
+QThreadPool &albert::interactiveThreadPool()
+{
+    static QThreadPool pool;
+    return pool;
+}
+
+QThreadPool &albert::backgroundThreadPool()
+{
+    static QThreadPool pool;
+    [[maybe_unused]] static const bool initialized = [] {
+        pool.setMaxThreadCount(max(1, QThread::idealThreadCount() / 2));
+        pool.setThreadPriority(QThread::LowPriority);
+        return true;
+    }();
+    return pool;
+}
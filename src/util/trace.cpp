@@ -0,0 +1,104 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "trace.h"
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <cstring>
+#include <mutex>
+#include <vector>
+using namespace Qt::StringLiterals;
+using namespace std::chrono;
+using namespace std;
+
+namespace
+{
+struct Event
+{
+    const char *category;
+    const char *name;
+    QString detail;
+    Trace::Clock::time_point begin;
+    Trace::Clock::time_point end;
+    quint64 thread;
+};
+
+mutex trace_mutex;
+vector<Event> startup;  // App and plugin spans. Never overwritten, dropped when full
+vector<Event> ring;  // Other spans. Grows up to capacity, then wraps
+size_t next = 0;
+const auto origin = Trace::Clock::now();  // Static initialization, roughly process start
+}
+
+// Frequent spans, e.g. of queries, must not overwrite the startup timeline
+static inline bool isStartup(const char *category)
+{ return strcmp(category, "app") == 0 || strcmp(category, "plugin") == 0; }
+
+static inline qint64 us(Trace::Clock::duration d) { return duration_cast<microseconds>(d).count(); }
+
+void Trace::record(const char *category, const char *name, const QString &detail,
+                   Clock::time_point begin, Clock::time_point end)
+{
+    Event event{category, name, detail, begin, end,
+                (quint64)reinterpret_cast<quintptr>(QThread::currentThreadId())};
+
+    lock_guard lock(trace_mutex);
+    if (isStartup(category))
+    {
+        if (startup.size() < Trace::startup_capacity)
+            startup.emplace_back(::move(event));
+    }
+    else
+    {
+        if (ring.size() < Trace::capacity)
+            ring.emplace_back(::move(event));
+        else
+            ring[next] = ::move(event);
+        next = (next + 1) % Trace::capacity;
+    }
+}
+
+QByteArray Trace::toChromeTrace()
+{
+    vector<Event> events;
+    {
+        lock_guard lock(trace_mutex);
+        events = startup;
+        events.insert(events.end(), ring.begin(), ring.end());
+    }
+
+    const auto pid = QCoreApplication::applicationPid();
+
+    QJsonArray trace_events;
+    for (const auto &e : events)
+    {
+        QJsonObject o{
+            {u"name"_s, QString::fromLatin1(e.name)},
+            {u"cat"_s, QString::fromLatin1(e.category)},
+            {u"ph"_s, u"X"_s},  // Complete event
+            {u"ts"_s, us(e.begin - origin)},
+            {u"dur"_s, us(e.end - e.begin)},
+            {u"pid"_s, pid},
+            {u"tid"_s, (qint64)e.thread}
+        };
+        if (!e.detail.isEmpty())
+            o.insert(u"args"_s, QJsonObject{{u"detail"_s, e.detail}});
+        trace_events.append(o);
+    }
+
+    return QJsonDocument(QJsonObject{
+        {u"traceEvents"_s, trace_events},
+        {u"displayTimeUnit"_s, u"ms"_s}
+    }).toJson(QJsonDocument::Compact);
+}
+
+Trace::Span::Span(const char *category, const char *name, QString detail)
+    : category_(category)
+    , name_(name)
+    , detail_(::move(detail))
+    , begin_(Clock::now())
+{}
+
+Trace::Span::~Span() { record(category_, name_, detail_, begin_); }
@@ -0,0 +1,67 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <chrono>
+
+///
+/// Lightweight timeline tracing.
+///
+/// Records spans of named operations along with the recording thread into a fixed size ring
+/// buffer. The oldest spans are overwritten. Spans of the categories `app` and `plugin` are kept
+/// in a separate buffer that is not overwritten, such that the startup timeline survives. The
+/// recorded timeline can be exported in the Chrome trace event format, e.g. to be viewed in
+/// chrome://tracing or https://ui.perfetto.dev.
+///
+/// Meant for coarse operations like plugin loading, index builds and query handling. Not for
+/// tight loops.
+///
+/// This class is thread-safe.
+///
+class Trace
+{
+public:
+
+    using Clock = std::chrono::steady_clock;
+
+    /// The number of spans kept, the oldest are overwritten.
+    static constexpr size_t capacity = 16384;
+
+    /// The number of startup spans kept, later ones are dropped.
+    static constexpr size_t startup_capacity = 4096;
+
+    ///
+    /// Records the span _name_ of _category_ from _begin_ to _end_ in the calling thread.
+    ///
+    /// _category_ and _name_ have to be string literals. _detail_ is an optional argument, e.g.
+    /// the id of a plugin. Traces end up in bug reports, _detail_ must not contain user input.
+    ///
+    static void record(const char *category, const char *name, const QString &detail,
+                       Clock::time_point begin, Clock::time_point end = Clock::now());
+
+    /// Returns the recorded spans in the Chrome trace event JSON format.
+    static QByteArray toChromeTrace();
+
+    ///
+    /// Records the lifetime of the object as span.
+    ///
+    /// \code
+    /// Trace::Span span("index", "build", id());
+    /// \endcode
+    ///
+    class Span
+    {
+    public:
+        Span(const char *category, const char *name, QString detail = {});
+        ~Span();
+        Span(const Span&) = delete;
+        Span &operator=(const Span&) = delete;
+
+    private:
+        const char *category_;
+        const char *name_;
+        const QString detail_;
+        const Clock::time_point begin_;
+    };
+};
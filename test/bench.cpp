@@ -0,0 +1,338 @@
+// Copyright (c) 2026 Manuel Schneider
+
+#include "config.h"
+#include "globalquery.h"
+#include "globalqueryhandler.h"
+#include "itemindex.h"
+#include "matcher.h"
+#include "query.h"
+#include "queryexecution.h"
+#include "rankitem.h"
+#include "standarditem.h"
+#include "usagescoring.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <ranges>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+using namespace Qt::StringLiterals;
+using namespace albert;
+using namespace std::chrono;
+using namespace std;
+
+//
+// Synthetic corpora
+//
+// Deterministic, the same size yields the same corpus on every machine and run.
+//
+
+static const QStringList words{
+    u"firefox"_s, u"thunderbird"_s, u"terminal"_s, u"settings"_s, u"calculator"_s,
+    u"document"_s, u"report"_s, u"invoice"_s, u"project"_s, u"backup"_s, u"photos"_s,
+    u"music"_s, u"kernel"_s, u"config"_s, u"notes"_s, u"budget"_s, u"meeting"_s,
+    u"draft"_s, u"archive"_s, u"release"_s, u"résumé"_s, u"straße"_s, u"manager"_s,
+    u"monitor"_s, u"editor"_s, u"viewer"_s, u"player"_s, u"studio"_s, u"browser"_s,
+    u"network"_s, u"printer"_s, u"scanner"_s, u"system"_s, u"update"_s, u"vacation"_s
+};
+
+static const QStringList directories{
+    u"/home/user/Documents"_s, u"/home/user/Downloads"_s, u"/home/user/Pictures/2024"_s,
+    u"/home/user/Projects/albert/src"_s, u"/home/user/.config"_s, u"/usr/share/doc"_s,
+    u"/opt/tools/bin"_s, u"/home/user/Music/Albums"_s
+};
+
+static const QStringList extensions{
+    u"pdf"_s, u"txt"_s, u"cpp"_s, u"h"_s, u"png"_s, u"jpg"_s, u"md"_s, u"json"_s, u"flac"_s
+};
+
+static vector<IndexItem> makeCorpus(size_t size)
+{
+    mt19937 rng(size);  // Seeded by size
+    const auto pick = [&](const QStringList &l) -> const QString & { return l[rng() % l.size()]; };
+
+    vector<IndexItem> corpus;
+    corpus.reserve(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        QString string;
+        if (i % 10 == 0)  // Apps, e.g. "Firefox Web Browser"
+            string = u"%1 %2 %3"_s.arg(pick(words), pick(words), pick(words));
+        else  // Files
+            string = u"%1/%2_%3_%4.%5"_s
+                         .arg(pick(directories), pick(words), pick(words))
+                         .arg(i).arg(pick(extensions));
+
+        auto item = StandardItem::make(QString::number(i), string, QString{},
+                                       []{ return unique_ptr<Icon>{}; });
+        corpus.emplace_back(::move(item), ::move(string));
+    }
+    return corpus;
+}
+
+static UsageScoring makeUsageScoring(const vector<IndexItem> &corpus)
+{
+    // Every 100th item has been used
+    auto scores = make_shared<unordered_map<ItemKey, double>>();
+    for (size_t i = 0; i < corpus.size(); i += 100)
+        scores->emplace(ItemKey{u"bench"_s, corpus[i].item->id()}, 1. / (1 + i % 7));
+    return UsageScoring{true, .5, ::move(scores)};
+}
+
+static vector<RankItem> makeRankItems(const vector<IndexItem> &corpus)
+{
+    mt19937 rng(corpus.size());
+    uniform_real_distribution<double> score(0., 1.);
+    vector<RankItem> rank_items;
+    rank_items.reserve(corpus.size());
+    for (const auto &index_item : corpus)
+        rank_items.emplace_back(index_item.item, score(rng));
+    return rank_items;
+}
+
+//
+// Harness
+//
+
+// Allocated bytes rather than resident pages. Freed heap is reused without growing the RSS.
+static qint64 heapInUseKiB()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    const auto info = mallinfo2();
+    return (qint64)(info.uordblks + info.hblkhd) / 1024;  // Including mmapped chunks
+#else
+    return -1;
+#endif
+}
+
+class Bench
+{
+public:
+
+    ///
+    /// Measures _fn_ repeatedly, at least three times and for at least 200 ms.
+    ///
+    /// _setup_ runs before each repetition and is not measured.
+    ///
+    void run(const QString &name, size_t corpus_size, auto fn, auto setup)
+    {
+        vector<double> samples;  // µs
+        const auto deadline = steady_clock::now() + 200ms;
+        while (samples.size() < 3 || (steady_clock::now() < deadline && samples.size() < 1000))
+        {
+            setup();
+            const auto tp = steady_clock::now();
+            fn();
+            samples.push_back(duration<double, micro>(steady_clock::now() - tp).count());
+        }
+
+        ranges::sort(samples);
+        QJsonObject result{
+            {u"name"_s, name},
+            {u"corpus_size"_s, (qint64)corpus_size},
+            {u"iterations"_s, (qint64)samples.size()},
+            {u"min_us"_s, samples.front()},
+            {u"median_us"_s, samples[samples.size() / 2]},
+            {u"max_us"_s, samples.back()}
+        };
+        cerr << qPrintable(name) << " (" << corpus_size << "): "
+             << samples[samples.size() / 2] << " µs" << endl;
+        results.append(result);
+    }
+
+    void run(const QString &name, size_t corpus_size, auto fn)
+    { run(name, corpus_size, fn, []{}); }
+
+    QJsonArray results;
+};
+
+//
+// End-to-end global query with mock handlers
+//
+
+class MockHandler : public GlobalQueryHandler
+{
+public:
+    MockHandler(QString id, vector<IndexItem> items) : id_(::move(id)) { index_.setItems(::move(items)); }
+    QString id() const override { return id_; }
+    QString name() const override { return id_; }
+    QString description() const override { return id_; }
+    vector<RankItem> rankItems(QueryContext &ctx) override
+    { return index_.search(ctx.query(), ctx.cancellationToken()); }
+
+private:
+    const QString id_;
+    ItemIndex index_;
+};
+
+static void runGlobalQuery(GlobalQuery &global_query, const UsageScoring &usage_scoring,
+                           const QString &string)
+{
+    detail::Query query(usage_scoring, {}, global_query, {}, string);
+    if (query.execution().isActive())
+    {
+        QEventLoop loop;
+        QObject::connect(&query.execution(), &QueryExecution::activeChanged,
+                         &loop, [&](bool active){ if (!active) loop.quit(); });
+        loop.exec();
+    }
+}
+
+//
+// Suite
+//
+
+static void benchmark(Bench &bench, size_t size, QJsonArray &memory)
+{
+    auto corpus = makeCorpus(size);
+    const auto strings = corpus | views::transform(&IndexItem::string);
+
+    // Footprint, before any other work on this corpus
+
+    {
+        const auto heap = heapInUseKiB();
+        auto copy = corpus;
+        ItemIndex index;
+        index.setItems(::move(copy));
+        memory.append(QJsonObject{
+            {u"corpus_size"_s, (qint64)size},
+            {u"index_heap_kib"_s, heap < 0 ? -1 : heapInUseKiB() - heap}
+        });
+    }
+
+    // Index construction
+
+    for (const bool fuzzy : {false, true})
+    {
+        vector<IndexItem> copy;
+        ItemIndex index({.fuzzy = fuzzy});
+        bench.run(fuzzy ? u"ItemIndex::setItems fuzzy"_s : u"ItemIndex::setItems"_s, size,
+                  [&]{ index.setItems(::move(copy)); },
+                  [&]{ copy = corpus; });
+    }
+
+    // Search
+
+    ItemIndex exact_index;
+    ItemIndex fuzzy_index({.fuzzy = true});
+    {
+        auto copy = corpus;
+        exact_index.setItems(::move(copy));
+        copy = corpus;
+        fuzzy_index.setItems(::move(copy));
+    }
+
+    const CancellationToken token;
+    bench.run(u"ItemIndex::search exact"_s, size, [&]{ exact_index.search(u"report"_s, token); });
+    bench.run(u"ItemIndex::search prefix"_s, size, [&]{ exact_index.search(u"re"_s, token); });
+    bench.run(u"ItemIndex::search fuzzy"_s, size, [&]{ fuzzy_index.search(u"reprot"_s, token); });
+    bench.run(u"ItemIndex::search multi-word"_s, size,
+              [&]{ exact_index.search(u"project draft pdf"_s, token); });
+
+    // Matcher
+
+    for (const auto &[name, string] : {pair{u"Matcher::match"_s, u"fire"_s},
+                                       pair{u"Matcher::match multi-word"_s, u"doc rep"_s}})
+    {
+        const Matcher matcher(string);
+        bench.run(name, size, [&]{
+            uint count = 0;
+            for (const auto &s : strings)
+                count += matcher.match(s) ? 1 : 0;
+            return count;
+        });
+    }
+
+    // Scoring and sorting
+
+    const auto usage_scoring = makeUsageScoring(corpus);
+    const auto rank_items = makeRankItems(corpus);
+    vector<RankItem> work;
+
+    bench.run(u"UsageScoring::modifyMatchScores"_s, size,
+              [&]{ usage_scoring.modifyMatchScores(u"bench"_s, work); },
+              [&]{ work = rank_items; });
+
+    bench.run(u"RankItem sort"_s, size,
+              [&]{ ranges::sort(work, greater{}); },
+              [&]{ work = rank_items; });
+
+    bench.run(u"RankItem partial sort 10"_s, size,
+              [&]{ ranges::partial_sort(work, work.begin() + min<size_t>(10, work.size()), greater{}); },
+              [&]{ work = rank_items; });
+
+    // End-to-end
+
+    GlobalQuery global_query;
+    vector<unique_ptr<MockHandler>> handlers;
+    const size_t handler_count = 8;
+    for (size_t h = 0; h < handler_count; ++h)
+    {
+        vector<IndexItem> slice;
+        for (size_t i = h; i < corpus.size(); i += handler_count)
+            slice.push_back(corpus[i]);
+        auto &handler = handlers.emplace_back(
+            make_unique<MockHandler>(u"mock%1"_s.arg(h), ::move(slice)));
+        global_query.handlers.emplace(handler->id(), handler.get());
+    }
+
+    bench.run(u"GlobalQueryExecution"_s, size,
+              [&]{ runGlobalQuery(global_query, usage_scoring, u"report"_s); });
+    bench.run(u"GlobalQueryExecution multi-word"_s, size,
+              [&]{ runGlobalQuery(global_query, usage_scoring, u"project draft"_s); });
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    auto opt_sizes = QCommandLineOption(
+        {u"s"_s, u"sizes"_s}, u"Corpus sizes. Comma separated."_s, u"sizes"_s,
+        u"10000,100000,1000000"_s);
+
+    auto opt_output = QCommandLineOption(
+        {u"o"_s, u"output"_s}, u"Write the JSON results to file instead of stdout."_s, u"file"_s);
+
+    QCommandLineParser parser;
+    parser.addOptions({opt_sizes, opt_output});
+    parser.addHelpOption();
+    parser.setApplicationDescription(u"Benchmarks the query pipeline."_s);
+    parser.process(app);
+
+    Bench bench;
+    QJsonArray memory;
+    for (const auto &size : parser.value(opt_sizes).split(u',', Qt::SkipEmptyParts))
+        benchmark(bench, size.toULongLong(), memory);
+
+    const auto json = QJsonDocument(QJsonObject{
+        {u"version"_s, QString::fromLatin1(ALBERT_VERSION_STRING)},
+        {u"qt_version"_s, QString::fromLatin1(qVersion())},
+        {u"cpu_architecture"_s, QSysInfo::currentCpuArchitecture()},
+        {u"benchmarks"_s, bench.results},
+        {u"memory"_s, memory}
+    }).toJson();
+
+    if (parser.isSet(opt_output))
+    {
+        QFile file(parser.value(opt_output));
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) < 0)
+        {
+            cerr << qPrintable(file.errorString()) << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    else
+        cout << json.constData();
+
+    return EXIT_SUCCESS;
+}
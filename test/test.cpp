@@ -1,26 +1,67 @@
 // Copyright (c) 2024-2025 Manuel Schneider
 
 #include "app.h"
+#include "cancellationtoken.h"
+#include "desktopentryparser.h"
+#include "desktopentryscanner.h"
 #include "extensionplugin.h"
 #include "extensionregistry.h"
+#include "frontend.h"
+#include "generatorqueryhandler.h"
+#include "globalquery.h"
+#include "globalqueryhandler.h"
 #include "icon.h"
+#include "iconloader.h"
+#include "iconlookup.h"
+#include "imageicon.h"
+#include "indexqueryhandler.h"
 #include "inputhistory.h"
 #include "itemindex.h"
 #include "levenshtein.h"
 #include "matcher.h"
+#include "mpscqueue.hpp"
 #include "plugininstance.h"
 #include "pluginloader.h"
 #include "pluginmetadata.h"
 #include "pluginprovider.h"
 #include "pluginregistry.h"
+#include "query.h"
+#include "queryexecution.h"
+#include "queryhandler.h"
+#include "querymetrics.h"
+#include "queryengine.h"
 #include "querypreprocessing.h"
+#include "queryresults.h"
+#include "resultcache.h"
+#include "session.h"
 #include "standarditem.h"
 #include "test.h"
+#include "themeindex.h"
 #include "topologicalsort.hpp"
+#include "trace.h"
+#include "usagescoring.h"
+#include <QCoreApplication>
+#include <QCoroGenerator>
+#include <QDataStream>
+#include <QDir>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocale>
+#include <QPainter>
+#include <QSignalSpy>
 #include <QSettings>
+#include <QTemporaryDir>
 #include <QTemporaryFile>
 #include <QTimer>
+#include <array>
+#include <atomic>
+#include <limits>
 #include <set>
+#include <thread>
 #include <unistd.h>
 using namespace Qt::StringLiterals;
 using namespace albert;
@@ -83,70 +124,70 @@ void AlbertTests::topological_sort_not_existing_node()
     QCOMPARE(result.error_set, expect);
 }
 
-void AlbertTests::plugin_registry()
+struct PluginInstanceMock : public ExtensionPlugin{};
+
+struct PluginLoaderMock : public PluginLoader
 {
-    using enum Plugin::State;
+    QString path_;
+    albert::PluginMetadata metadata_;
+    unique_ptr<PluginInstanceMock> instance_;
+
+    PluginLoaderMock(const QString &id):
+        path_("/mock/plugin/" + id),
+        metadata_{
+            .id=id,
+            .version="1.0.0",
+            .name=id,
+            .description=id + " description"
+        }
+    {}
+    ~PluginLoaderMock() {}
 
-    struct PluginInstanceMock : public ExtensionPlugin{};
+    QString path() const noexcept override { return path_; }
+    const albert::PluginMetadata &metadata() const noexcept override { return metadata_; }
+    albert::PluginInstance *instance() noexcept override { return instance_.get(); }
+};
 
-    struct PluginLoaderMock : public PluginLoader
-    {
-        QString path_;
-        albert::PluginMetadata metadata_;
-        unique_ptr<PluginInstanceMock> instance_;
-
-        PluginLoaderMock(const QString &id):
-            path_("/mock/plugin/" + id),
-            metadata_{
-                .id=id,
-                .version="1.0.0",
-                .name=id,
-                .description=id + " description"
-            }
-        {}
-        ~PluginLoaderMock() {}
-
-        QString path() const noexcept override { return path_; }
-        const albert::PluginMetadata &metadata() const noexcept override { return metadata_; }
-        albert::PluginInstance *instance() noexcept override { return instance_.get(); }
-    };
+struct SyncPluginLoaderMock : public PluginLoaderMock
+{
+    using PluginLoaderMock::PluginLoaderMock;
 
-    struct SyncPluginLoaderMock : public PluginLoaderMock
+    void load() noexcept override
     {
-        using PluginLoaderMock::PluginLoaderMock;
-
-        void load() noexcept override
-        {
-            PluginLoader::current_loader = this;
-            instance_ = make_unique<PluginInstanceMock>();
-            emit finished({});
-        }
-        void unload() noexcept override
-        {
-            instance_.reset();
-        }
-    };
-
-    struct AsyncPluginLoaderMock : public SyncPluginLoaderMock
+        PluginLoader::current_loader = this;
+        instance_ = make_unique<PluginInstanceMock>();
+        emit finished({});
+    }
+    void unload() noexcept override
     {
-        using SyncPluginLoaderMock::SyncPluginLoaderMock;
-        void load() noexcept override
-        {
-            QTimer::singleShot(10, this,  [this](){ SyncPluginLoaderMock::load(); });
-        }
-    };
+        instance_.reset();
+    }
+};
 
-    struct PluginProviderMock : public PluginProvider
+struct AsyncPluginLoaderMock : public SyncPluginLoaderMock
+{
+    using SyncPluginLoaderMock::SyncPluginLoaderMock;
+    void load() noexcept override
     {
-        vector<PluginLoader *> loaders_;
-        PluginProviderMock(vector<PluginLoader*> p) : loaders_(p){}
+        QTimer::singleShot(10, this,  [this](){ SyncPluginLoaderMock::load(); });
+    }
+};
 
-        QString id() const noexcept override { return "testpluginprovider"; }
-        QString name() const noexcept override { return "Mock Plugin Provider"; }
-        QString description() const noexcept override { return "Mock Plugin Provider Description"; }
+struct PluginProviderMock : public PluginProvider
+{
+    vector<PluginLoader *> loaders_;
+    PluginProviderMock(vector<PluginLoader*> p) : loaders_(p){}
 
-        vector<PluginLoader *> plugins() const override { return loaders_; }
-    };
+    QString id() const noexcept override { return "testpluginprovider"; }
+    QString name() const noexcept override { return "Mock Plugin Provider"; }
+    QString description() const noexcept override { return "Mock Plugin Provider Description"; }
+
+    vector<PluginLoader *> plugins() const override { return loaders_; }
+};
+
+void AlbertTests::plugin_registry()
+{
+    using enum Plugin::State;
 
     // Diamond
     auto *loader0 = new AsyncPluginLoaderMock{"testplugin0"};
@@ -311,6 +352,74 @@ void AlbertTests::plugin_registry()
     QVERIFY(plu_reg.plugins().contains("testplugin0"));
 }
 
+void AlbertTests::plugin_registry_deferral()
+{
+    using enum Plugin::State;
+
+    // Trigger-only plugins are deferred unless enabled plugins depend on them
+    auto *deferred = new AsyncPluginLoaderMock{u"testdeferred"_s};
+    auto *disabled = new AsyncPluginLoaderMock{u"testdeferreddisabled"_s};
+    auto *dependency = new AsyncPluginLoaderMock{u"testdependency"_s};
+    auto *dependee = new AsyncPluginLoaderMock{u"testdependee"_s};
+    for (auto *loader : {deferred, disabled, dependency})
+    {
+        loader->metadata_.triggers = {loader->metadata_.id + u" "_s};
+        loader->metadata_.handler_kinds = {u"trigger"_s};
+    }
+    dependee->metadata_.plugin_dependencies = {u"testdependency"_s};
+
+    const auto loaders = vector<PluginLoader*>{deferred, disabled, dependency, dependee};
+    for (const auto &loader : loaders)
+        app().settings()->setValue(QString("%1/enabled").arg(loader->metadata().id), true);
+
+    PluginProviderMock provider(loaders);
+    ExtensionRegistry ext_reg;
+    PluginRegistry plu_reg(ext_reg, true);
+
+    vector<pair<QString, bool>> deferral_changes;
+    connect(&plu_reg, &PluginRegistry::pluginDeferralChanged,
+            this, [&](const QString &id, bool d) { deferral_changes.emplace_back(id, d); });
+
+    ext_reg.registerExtension(&provider);
+
+    const auto &p_deferred = plu_reg.plugins().at(u"testdeferred"_s);
+    const auto &p_disabled = plu_reg.plugins().at(u"testdeferreddisabled"_s);
+    const auto &p_dependency = plu_reg.plugins().at(u"testdependency"_s);
+    const auto &p_dependee = plu_reg.plugins().at(u"testdependee"_s);
+
+    ranges::sort(deferral_changes);  // Order of plugins of a provider is unspecified
+    QCOMPARE(deferral_changes, (vector<pair<QString, bool>>{{u"testdeferred"_s, true},
+                                                            {u"testdeferreddisabled"_s, true}}));
+    QTRY_COMPARE(p_dependee.state, Loaded);
+    QCOMPARE(p_dependency.state, Loaded);
+    QCOMPARE(p_deferred.state, Unloaded);
+    QCOMPARE(p_disabled.state, Unloaded);
+
+    // Activation loads deferred plugins only
+    deferral_changes.clear();
+    plu_reg.activate(u"testdependee"_s);
+    plu_reg.activate(u"testnonexistent"_s);
+    QVERIFY(deferral_changes.empty());
+
+    plu_reg.activate(u"testdeferred"_s);
+    QCOMPARE(deferral_changes, (vector<pair<QString, bool>>{{u"testdeferred"_s, false}}));
+    QTRY_COMPARE(p_deferred.state, Loaded);
+    QVERIFY(ext_reg.extensions().contains(u"testdeferred"_s));
+
+    plu_reg.activate(u"testdeferred"_s);  // Once
+    QCOMPARE(deferral_changes.size(), 1u);
+
+    // Disabling undefers without loading
+    deferral_changes.clear();
+    plu_reg.setEnabled(u"testdeferreddisabled"_s, false);
+    QCOMPARE(deferral_changes,
+             (vector<pair<QString, bool>>{{u"testdeferreddisabled"_s, false}}));
+    QTest::qWait(50);
+    QCOMPARE(p_disabled.state, Unloaded);
+
+    ext_reg.deregisterExtension(&provider);
+}
+
 void AlbertTests::bench_tokenizer()
 {
     static const auto test_split_string =
@@ -638,7 +747,7 @@ static auto indexMatch(const QStringList &item_strings,
 
     index.setItems(::move(index_items));
 
-    return index.search(search_string, [] { return true; });
+    return index.search(search_string, CancellationToken());
 };
 
 void AlbertTests::index_empty()
@@ -737,6 +846,891 @@ void AlbertTests::index_score()
     QCOMPARE(m[1].score, 3./4.);
 }
 
+void AlbertTests::cancellation_token()
+{
+    CancellationToken token;
+    QVERIFY(!token.isCancelled());
+    QCOMPARE(token.deadline(), CancellationToken::Clock::time_point::max());
+
+    int calls = 0;
+    token.onCancelled([&] { ++calls; });
+    auto id = token.onCancelled([&] { ++calls; });
+    token.removeCallback(id);
+
+    auto child = token.child();
+    child.setTimeout(-1ms);
+    QVERIFY(child.isCancelled());
+    QVERIFY(!token.isCancelled());
+
+    auto copy = token;
+    copy.cancel();
+    copy.cancel();
+    QVERIFY(token.isCancelled());
+    QVERIFY(token.child().isCancelled());
+    QCOMPARE(calls, 1);
+
+    token.onCancelled([&] { ++calls; });  // Invoked immediately
+    QCOMPARE(calls, 2);
+
+    // Cancelled searches return nothing
+    ItemIndex index({.fuzzy = true});
+    vector<IndexItem> index_items;
+    index_items.emplace_back(StandardItem::make(u"abc"_s, {}, {}, {}), u"abc def"_s);
+    index.setItems(::move(index_items));
+    QCOMPARE(index.search(u"abc def"_s, CancellationToken()).size(), 1);
+    QVERIFY(index.search(u"abc def"_s, token).empty());
+}
+
+void AlbertTests::metric_series_percentiles()
+{
+    MetricSeries s;
+    QCOMPARE(s.size(), 0u);
+    QCOMPARE(s.percentiles().p50, 0u);
+    QCOMPARE(s.percentiles().p99, 0u);
+
+    s.add(7);
+    QCOMPARE(s.size(), 1u);
+    QCOMPARE(s.percentiles().p50, 7u);
+    QCOMPARE(s.percentiles().p95, 7u);
+    QCOMPARE(s.percentiles().p99, 7u);
+
+    // Insertion order does not matter
+    MetricSeries t;
+    for (uint i = 100; i > 0; --i)
+        t.add(i);
+    QCOMPARE(t.size(), 100u);
+    QCOMPARE(t.percentiles().p50, 51u);
+    QCOMPARE(t.percentiles().p95, 96u);
+    QCOMPARE(t.percentiles().p99, 100u);
+}
+
+void AlbertTests::metric_series_ring_overwrite()
+{
+    MetricSeries s;
+    for (uint i = 0; i < MetricSeries::capacity; ++i)
+        s.add(1000000);
+    QCOMPARE(s.size(), MetricSeries::capacity);
+    QCOMPARE(s.percentiles().p50, 1000000u);
+
+    // The most recent samples are retained
+    for (uint i = 0; i < MetricSeries::capacity; ++i)
+        s.add(i);
+    QCOMPARE(s.size(), MetricSeries::capacity);
+    QCOMPARE(s.percentiles().p50, 128u);
+    QCOMPARE(s.percentiles().p95, 243u);
+    QCOMPARE(s.percentiles().p99, 253u);
+
+    s.add(5000);  // Replaces 0, the oldest
+    QCOMPARE(s.size(), MetricSeries::capacity);
+    QCOMPARE(s.percentiles().p50, 129u);
+    QCOMPARE(s.percentiles().p99, 254u);
+}
+
+void AlbertTests::result_cache()
+{
+    ResultCache cache(1024 * 1024);
+    vector<RankItem> results{{StandardItem::make(u"a"_s, u"a"_s, {}, {}), 1.f}};
+
+    cache.put(u"h"_s, u"Foo  bar"_s, 1, 0, results);
+    QVERIFY(cache.size() > 0);
+
+    // Normalized query
+    auto cached = cache.get(u"h"_s, u"foo bar"_s, 1);
+    QVERIFY(cached);
+    QVERIFY(cached->size() == 1);
+    QCOMPARE(cached->front().item, results.front().item);
+
+    QVERIFY(!cache.get(u"x"_s, u"foo bar"_s, 1));
+    QVERIFY(!cache.get(u"h"_s, u"foo"_s, 1));
+
+    // Generation change invalidates
+    QVERIFY(!cache.get(u"h"_s, u"foo bar"_s, 2));
+    QVERIFY(!cache.get(u"h"_s, u"foo bar"_s, 1));
+    QVERIFY(cache.size() == 0);
+
+    // A new generation purges the entries of previous ones
+    cache.put(u"h"_s, u"a"_s, 1, 0, results);
+    cache.put(u"h"_s, u"b"_s, 1, 0, results);
+    const auto size = cache.size();
+    cache.put(u"h"_s, u"c"_s, 2, 0, results);
+    QCOMPARE(cache.size(), size / 2);
+    QVERIFY(cache.get(u"h"_s, u"c"_s, 2));
+    cache.remove(u"h"_s);
+    QVERIFY(cache.size() == 0);
+
+    cache.put(u"h"_s, u"a"_s, 1, 0, results);
+    cache.put(u"i"_s, u"a"_s, 1, 0, results);
+    cache.remove(u"h"_s);
+    QVERIFY(!cache.get(u"h"_s, u"a"_s, 1));
+    QVERIFY(cache.get(u"i"_s, u"a"_s, 1));
+
+    // Eviction of the least recently used
+    cache.put(u"h"_s, u"a"_s, 1, 0, results);
+    cache.setCapacity(cache.size() / 2 + 1);
+    QVERIFY(cache.get(u"h"_s, u"a"_s, 1));
+    QVERIFY(!cache.get(u"i"_s, u"a"_s, 1));
+
+    cache.clear();
+    QVERIFY(cache.size() == 0);
+
+    // Results scored before the clear are dropped
+    QCOMPARE(cache.epoch(), 1u);
+    cache.put(u"h"_s, u"a"_s, 1, 0, results);
+    QVERIFY(!cache.get(u"h"_s, u"a"_s, 1));
+    cache.put(u"h"_s, u"a"_s, 1, 1, results);
+    QVERIFY(cache.get(u"h"_s, u"a"_s, 1));
+}
+
+void AlbertTests::index_query_handler_caching()
+{
+    class Handler : public IndexQueryHandler
+    {
+    public:
+        QString id() const override { return u"index"_s; }
+        QString name() const override { return id(); }
+        QString description() const override { return id(); }
+        void updateIndexItems() override { setIndexItems({}); }
+        uint generation() const { return indexGeneration(); }
+    } h;
+
+    // Subclasses may override rankItems, caching is opt-in
+    QCOMPARE(h.resultGeneration(), 0u);
+
+    const auto generation = h.generation();
+    h.setFuzzyMatching(true);
+    QVERIFY(h.generation() != generation);
+}
+
+namespace
+{
+
+class MockHandler : public QueryHandler
+{
+public:
+    QString id() const override { return u"mock"_s; }
+    QString name() const override { return u"mock"_s; }
+    QString description() const override { return u"mock"_s; }
+    unique_ptr<QueryExecution> execution(QueryContext &) override { return {}; }
+};
+
+class MockContext : public QueryContext
+{
+public:
+    bool isValid() const override { return true; }
+    const CancellationToken &cancellationToken() const override { return token; }
+    const QueryHandler &handler() const override { return query_handler; }
+    QString trigger() const override { return {}; }
+    QString query() const override { return {}; }
+    const UsageScoring &usageScoring() const override { return usage_scoring; }
+
+    CancellationToken token;
+    MockHandler query_handler;
+    UsageScoring usage_scoring{false, .5, {}};
+};
+
+class MockDynamicItem : public detail::DynamicItem
+{
+public:
+    MockDynamicItem(QString id) : id_(::move(id)) {}
+    QString id() const override { return id_; }
+    QString text() const override { return id_; }
+    QString subtext() const override { return {}; }
+    unique_ptr<Icon> icon() const override { return {}; }
+private:
+    const QString id_;
+};
+
+struct QueryResultsFixture
+{
+    QueryResultsFixture()
+    {
+        for (const auto &id : {u"a"_s, u"b"_s, u"c"_s})
+            items.emplace_back(make_shared<MockDynamicItem>(id));
+        for (const auto &item : items)
+            results.add(item);
+    }
+
+    MockContext context;
+    QueryResults results{context};
+    vector<shared_ptr<MockDynamicItem>> items;
+    QSignalSpy range_spy{&results, &QueryResults::resultsChanged};
+    QSignalSpy row_spy{&results, &QueryResults::resultChanged};
+};
+
+
+class MockGlobalHandler : public GlobalQueryHandler
+{
+public:
+    MockGlobalHandler(QString id, vector<RankItem> items = {})
+        : id_(::move(id)), items_(::move(items)) {}
+    QString id() const override { return id_; }
+    QString name() const override { return id_; }
+    QString description() const override { return id_; }
+    vector<RankItem> rankItems(QueryContext &) override { return items_; }
+
+    vector<RankItem> items_;
+private:
+    const QString id_;
+};
+
+static UsageScoring nullUsageScoring()
+{ return UsageScoring{false, .5, make_shared<const unordered_map<ItemKey, double>>()}; }
+
+class MockFrontend : public detail::Frontend
+{
+public:
+    bool isVisible() const override { return true; }
+    void setVisible(bool) override {}
+    QString input() const override { return input_; }
+    void setInput(const QString &input) override { emit inputChanged(input_ = input); }
+    unsigned long long winId() const override { return 0; }
+    QWidget *createFrontendConfigWidget() override { return nullptr; }
+    void setQuery(detail::Query *query) override
+    {
+        if (query)
+            QObject::connect(&query->matches(), &QObject::destroyed, [this]{ ++deleted_queries; });
+        this->query = query;
+    }
+
+    QString input_;
+    detail::Query *query = nullptr;
+    int deleted_queries = 0;
+};
+
+// Ignores cancellation, like handlers calling blocking APIs
+class BlockingGlobalHandler : public GlobalQueryHandler
+{
+public:
+    QString id() const override { return u"blocking"_s; }
+    QString name() const override { return id(); }
+    QString description() const override { return id(); }
+    vector<RankItem> rankItems(QueryContext &) override
+    {
+        while (!released)
+            this_thread::sleep_for(1ms);
+        return items;
+    }
+    atomic_bool released = false;
+    vector<RankItem> items;
+};
+
+class BlockingEmptyQueryHandler : public GlobalQueryHandler
+{
+public:
+    QString id() const override { return u"empty"_s; }
+    QString name() const override { return id(); }
+    QString description() const override { return id(); }
+    vector<RankItem> rankItems(QueryContext &) override { return {}; }
+    vector<shared_ptr<Item>> handleEmptyQuery() override
+    {
+        ++calls;
+        while (!released)
+            this_thread::sleep_for(1ms);
+        auto item = make_shared<MockDynamicItem>(u"e"_s);
+        produced = item;
+        return {item};
+    }
+    atomic_uint calls = 0;
+    atomic_bool released = false;
+    weak_ptr<Item> produced;
+};
+
+static void awaitInactive(detail::Query &query)
+{
+    if (query.execution().isActive())
+    {
+        QEventLoop loop;
+        QObject::connect(&query.execution(), &QueryExecution::activeChanged,
+                         &loop, [&](bool active){ if (!active) loop.quit(); });
+        loop.exec();
+    }
+}
+
+class MockGeneratorHandler : public GeneratorQueryHandler
+{
+public:
+    MockGeneratorHandler(uint read_ahead = 0) : read_ahead_(read_ahead) {}
+    QString id() const override { return u"generator"_s; }
+    QString name() const override { return id(); }
+    QString description() const override { return id(); }
+    uint readAhead() const override { return read_ahead_; }
+    ItemGenerator items(QueryContext &) override
+    {
+        for (uint step = 1; step <= 5; ++step)
+        {
+            steps = step;
+            while (step >= blocking_step && !released)
+                this_thread::sleep_for(1ms);
+            vector<shared_ptr<Item>> batch;
+            for (uint i = 0; i < batchSize(); ++i)
+                batch.emplace_back(make_shared<MockDynamicItem>(QString::number(i)));
+            co_yield batch;
+        }
+    }
+    atomic_uint steps = 0;  // Generator steps started
+    atomic_uint blocking_step = numeric_limits<uint>::max();
+    atomic_bool released = false;
+private:
+    const uint read_ahead_;
+};
+
+static shared_ptr<StandardItem> makeIdentityItem(const QString &id, const QString &identity,
+                                                 const QString &action_id)
+{
+    auto item = StandardItem::make(id, id, QString{}, []() -> unique_ptr<Icon> { return {}; },
+                                   vector<Action>{Action{action_id, action_id, []{}}});
+    item->setIdentity(identity);
+    return item;
+}
+
+static QStringList actionIds(const Item &item)
+{
+    QStringList ids;
+    for (const auto &action : item.actions())
+        ids << action.id;
+    return ids;
+}
+
+}
+
+void AlbertTests::query_results_coalesced_changes()
+{
+    QueryResultsFixture f;
+
+    f.items[2]->dataChanged();
+    f.items[1]->dataChanged();
+    f.items[2]->dataChanged();
+    QCOMPARE(f.range_spy.count(), 0);  // Not before the next event loop pass
+
+    QTRY_COMPARE(f.range_spy.count(), 1);
+    QCOMPARE(f.range_spy.at(0).at(0).toInt(), 1);
+    QCOMPARE(f.range_spy.at(0).at(1).toInt(), 2);
+    QCOMPARE(f.row_spy.count(), 2);
+    QCOMPARE(f.row_spy.at(0).at(0).toUInt(), 1u);
+    QCOMPARE(f.row_spy.at(1).at(0).toUInt(), 2u);
+
+    // No further signals
+    QCoreApplication::processEvents();
+    QCOMPARE(f.range_spy.count(), 1);
+}
+
+void AlbertTests::query_results_rows_after_remove()
+{
+    QueryResultsFixture f;
+
+    f.results.remove(0);
+    f.items[2]->dataChanged();
+    QTRY_COMPARE(f.range_spy.count(), 1);
+    QCOMPARE(f.range_spy.at(0).at(0).toInt(), 1);
+    QCOMPARE(f.range_spy.at(0).at(1).toInt(), 1);
+
+    // Removed items are not observed anymore
+    f.items[0]->dataChanged();
+    QCoreApplication::processEvents();
+    QCoreApplication::processEvents();
+    QCOMPARE(f.range_spy.count(), 1);
+
+    // Items added twice map to both rows
+    f.results.add(f.items[1]);
+    f.items[1]->dataChanged();
+    QTRY_COMPARE(f.range_spy.count(), 2);
+    QCOMPARE(f.range_spy.at(1).at(0).toInt(), 0);
+    QCOMPARE(f.range_spy.at(1).at(1).toInt(), 2);
+    QCOMPARE(f.row_spy.count(), 3);
+
+    f.results.reset();
+    f.items[1]->dataChanged();
+    QCoreApplication::processEvents();
+    QCoreApplication::processEvents();
+    QCOMPARE(f.range_spy.count(), 2);
+}
+
+void AlbertTests::query_results_deferred_changes()
+{
+    QueryResultsFixture f;
+    f.results.setVisibleRange(0, 0);
+
+    f.items[0]->dataChanged();
+    f.items[2]->dataChanged();
+
+    // Visible rows first
+    QTRY_COMPARE(f.range_spy.count(), 1);
+    QCOMPARE(f.range_spy.at(0).at(0).toInt(), 0);
+    QCOMPARE(f.range_spy.at(0).at(1).toInt(), 0);
+
+    // Invisible rows deferred
+    QTRY_COMPARE(f.range_spy.count(), 2);
+    QCOMPARE(f.range_spy.at(1).at(0).toInt(), 2);
+    QCOMPARE(f.range_spy.at(1).at(1).toInt(), 2);
+
+    // Scrolled into view
+    f.items[1]->dataChanged();
+    QTRY_COMPARE(f.range_spy.count(), 3);
+    f.items[2]->dataChanged();
+    QCoreApplication::processEvents();
+    QCoreApplication::processEvents();
+    f.results.setVisibleRange(2, 2);
+    QCOMPARE(f.range_spy.count(), 4);
+    QCOMPARE(f.range_spy.at(3).at(0).toInt(), 2);
+}
+
+void AlbertTests::item_change_hub_removed_observers()
+{
+    struct Observer : public Item::Observer
+    {
+        void onItemChanged(const Item *) override
+        {
+            ++calls;
+            item->removeObserver(other);  // Collected in the same flush
+        }
+        MockDynamicItem *item;
+        Observer *other;
+        int calls = 0;
+    };
+
+    MockDynamicItem item(u"a"_s);
+    Observer a, b;
+    a.item = b.item = &item;
+    a.other = &b;
+    b.other = &a;
+    item.addObserver(&a);
+    item.addObserver(&b);
+
+    item.dataChanged();
+    QTRY_COMPARE(a.calls + b.calls, 1);
+    QCoreApplication::processEvents();
+    QCOMPARE(a.calls + b.calls, 1);
+}
+
+void AlbertTests::global_query_deduplication_merge()
+{
+    MockGlobalHandler a(u"a"_s, {RankItem(makeIdentityItem(u"a"_s, u"/x"_s, u"copy"_s), .5)});
+    MockGlobalHandler b(u"b"_s, {RankItem(makeIdentityItem(u"b"_s, u"/x"_s, u"open"_s), .8),
+                                 RankItem(makeIdentityItem(u"c"_s, {}, u"open"_s), .7)});
+    GlobalQuery global_query;
+    global_query.deduplicate = true;
+    global_query.handlers = {{a.id(), &a}, {b.id(), &b}};
+
+    detail::Query query(nullUsageScoring(), {}, global_query, {}, u"x"_s);
+    awaitInactive(query);
+    while (query.execution().canFetchMore())
+        query.execution().fetchMore();
+
+    // Items without identity are never merged
+    QCOMPARE(query.matches().count(), 2u);
+
+    // The higher scored item is presented, the duplicate contributes its actions
+    QCOMPARE(query.matches()[0].item->id(), u"b"_s);
+    QCOMPARE(actionIds(*query.matches()[0].item), QStringList({u"open"_s, u"copy"_s}));
+    QCOMPARE(query.matches()[1].item->id(), u"c"_s);
+}
+
+void AlbertTests::global_query_deduplication_winner()
+{
+    // Both orders of arrival present the higher scored item
+    for (const auto &[first, second] : {pair{.9, .4}, pair{.4, .9}})
+    {
+        MockGlobalHandler h(u"h"_s, {RankItem(makeIdentityItem(u"first"_s, u"/x"_s, u"a"_s), first),
+                                     RankItem(makeIdentityItem(u"second"_s, u"/x"_s, u"a"_s), second)});
+        GlobalQuery global_query;
+        global_query.deduplicate = true;
+        global_query.handlers = {{h.id(), &h}};
+
+        detail::Query query(nullUsageScoring(), {}, global_query, {}, u"x"_s);
+        awaitInactive(query);
+
+        QCOMPARE(query.matches().count(), 1u);
+        QCOMPARE(query.matches()[0].item->id(), first > second ? u"first"_s : u"second"_s);
+        QCOMPARE(actionIds(*query.matches()[0].item), QStringList({u"a"_s}));  // Action ids unique
+    }
+
+    // Disabled by default
+    MockGlobalHandler h(u"h"_s, {RankItem(makeIdentityItem(u"a"_s, u"/x"_s, u"a"_s), .5),
+                                 RankItem(makeIdentityItem(u"b"_s, u"/x"_s, u"b"_s), .5)});
+    GlobalQuery global_query;
+    global_query.handlers = {{h.id(), &h}};
+    detail::Query query(nullUsageScoring(), {}, global_query, {}, u"x"_s);
+    awaitInactive(query);
+    QCOMPARE(query.matches().count(), 2u);
+}
+
+void AlbertTests::global_query_deduplication_nested()
+{
+    // The third duplicate outscores the merged item, which is then merged into the new winner
+    MockGlobalHandler h(u"h"_s, {RankItem(makeIdentityItem(u"a"_s, u"/x"_s, u"a"_s), .5),
+                                 RankItem(makeIdentityItem(u"b"_s, u"/x"_s, u"b"_s), .7),
+                                 RankItem(makeIdentityItem(u"c"_s, u"/x"_s, u"c"_s), .9)});
+    GlobalQuery global_query;
+    global_query.deduplicate = true;
+    global_query.handlers = {{h.id(), &h}};
+
+    detail::Query query(nullUsageScoring(), {}, global_query, {}, u"x"_s);
+    awaitInactive(query);
+
+    QCOMPARE(query.matches().count(), 1u);
+    QCOMPARE(query.matches()[0].item->id(), u"c"_s);
+    QCOMPARE(query.matches()[0].item->identity(), u"/x"_s);
+    QCOMPARE(actionIds(*query.matches()[0].item), QStringList({u"c"_s, u"b"_s, u"a"_s}));
+}
+
+void AlbertTests::global_query_schedule()
+{
+    MockGlobalHandler a(u"a"_s), b(u"b"_s), c(u"c"_s);
+    GlobalQuery global_query;
+    global_query.handlers = {{a.id(), &a}, {b.id(), &b}, {c.id(), &c}};
+    global_query.default_budget = 20ms;
+    global_query.budgets = {{b.id(), 5ms}};
+    global_query.updateStatistics(a.id(), 50, 0);
+    global_query.updateStatistics(b.id(), 1, 10);
+
+    // Unknown handlers first to gather statistics, then fast high-hit handlers
+    const auto schedule = global_query.schedule();
+    QCOMPARE(schedule.size(), 3u);
+    QCOMPARE(schedule[0].handler->id(), u"c"_s);
+    QCOMPARE(schedule[1].handler->id(), u"b"_s);
+    QCOMPARE(schedule[2].handler->id(), u"a"_s);
+    QVERIFY(schedule[0].budget == 20ms);
+    QVERIFY(schedule[1].budget == 5ms);
+}
+
+void AlbertTests::global_query_budget_deadline()
+{
+    MockGlobalHandler fast(u"fast"_s, {RankItem(make_shared<MockDynamicItem>(u"fast"_s), .5)});
+    BlockingGlobalHandler slow;
+    slow.items = {RankItem(make_shared<MockDynamicItem>(u"slow"_s), .9)};
+    GlobalQuery global_query;
+    global_query.default_budget = 50ms;
+    global_query.handlers = {{fast.id(), &fast}, {slow.id(), &slow}};
+    global_query.updateStatistics(slow.id(), 1000, 0);  // Scheduled last, even on a single thread
+
+    detail::Query query(nullUsageScoring(), {}, global_query, {}, u"x"_s);
+
+    // Published at the deadline, the overrunning handler does not hold back the others
+    QTRY_COMPARE(query.matches().count(), 1u);
+    QVERIFY(query.execution().isActive());
+    QCOMPARE(query.matches()[0].item->id(), u"fast"_s);
+
+    // Late results are appended as they arrive, regardless of their score
+    slow.released = true;
+    awaitInactive(query);
+    QCOMPARE(query.matches().count(), 2u);
+    QCOMPARE(query.matches()[1].item->id(), u"slow"_s);
+    QCOMPARE(global_query.statistics[slow.id()].samples, 2u);
+}
+
+void AlbertTests::global_query_budget_drop_overruns()
+{
+    MockGlobalHandler fast(u"fast"_s, {RankItem(make_shared<MockDynamicItem>(u"fast"_s), .5)});
+    BlockingGlobalHandler slow;
+    slow.items = {RankItem(make_shared<MockDynamicItem>(u"slow"_s), .9)};
+    GlobalQuery global_query;
+    global_query.default_budget = 50ms;
+    global_query.drop_overrun_results = true;
+    global_query.handlers = {{fast.id(), &fast}, {slow.id(), &slow}};
+    global_query.updateStatistics(slow.id(), 1000, 0);
+
+    detail::Query query(nullUsageScoring(), {}, global_query, {}, u"x"_s);
+    QTRY_COMPARE(query.matches().count(), 1u);
+
+    slow.released = true;
+    awaitInactive(query);
+    QCOMPARE(query.matches().count(), 1u);
+    QVERIFY(!query.execution().canFetchMore());
+}
+
+void AlbertTests::generator_query_on_demand()
+{
+    MockGeneratorHandler h;
+    detail::Query query(nullUsageScoring(), {}, h, {}, u"x"_s);
+    awaitInactive(query);
+    QCOMPARE(query.matches().count(), 10u);
+
+    // No batches are computed ahead by default
+    QTest::qWait(50);
+    QCOMPARE(h.steps.load(), 1u);
+
+    query.execution().fetchMore();
+    QVERIFY(query.execution().isActive());
+    awaitInactive(query);
+    QCOMPARE(h.steps.load(), 2u);
+}
+
+void AlbertTests::generator_query_read_ahead()
+{
+    MockGeneratorHandler h(1);
+    detail::Query query(nullUsageScoring(), {}, h, {}, u"x"_s);
+    awaitInactive(query);
+    const auto count = query.matches().count();
+
+    // The read-ahead step does not report activity
+    QTRY_COMPARE(h.steps.load(), 2u);
+    QVERIFY(!query.execution().isActive());
+    QTest::qWait(50);
+
+    // The prefetched batch is served without generator step, the next one is computed ahead
+    query.execution().fetchMore();
+    QVERIFY(!query.execution().isActive());
+    QVERIFY(query.matches().count() > count);
+    QTRY_COMPARE(h.steps.load(), 3u);
+}
+
+void AlbertTests::generator_query_cancel_while_stepping()
+{
+    MockGeneratorHandler h(1);
+    h.blocking_step = 2;
+    detail::Query query(nullUsageScoring(), {}, h, {}, u"x"_s);
+    awaitInactive(query);
+    const auto count = query.matches().count();
+    QTRY_COMPARE(h.steps.load(), 2u);
+
+    // A running read-ahead step is reported, owners await inactivity before deleting executions
+    QSignalSpy spy(&query.execution(), &QueryExecution::activeChanged);
+    query.cancel();
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy[0][0].toBool(), true);
+
+    // The results of the step are dropped
+    h.released = true;
+    awaitInactive(query);
+    QCOMPARE(query.matches().count(), count);
+    QVERIFY(!query.execution().canFetchMore());
+    QCOMPARE(h.steps.load(), 2u);
+}
+
+void AlbertTests::generator_query_batch_sizes()
+{
+    {
+        MockGeneratorHandler h;
+        detail::Query query(nullUsageScoring(), {}, h, {}, u"x"_s);
+
+        // Set by the frontend after the query has been constructed
+        query.execution().setViewportSize(3);
+
+        // The first batch fills the viewport, requested batches grow
+        awaitInactive(query);
+        QCOMPARE(query.matches().count(), 3u);
+        query.execution().fetchMore();
+        awaitInactive(query);
+        QCOMPARE(query.matches().count(), 3u + 6u);
+    }
+    {
+        MockGeneratorHandler h(1);
+        detail::Query query(nullUsageScoring(), {}, h, {}, u"x"_s);
+        query.execution().setViewportSize(3);
+        awaitInactive(query);
+        QCOMPARE(query.matches().count(), 3u);
+
+        // Read-ahead batches reuse the size of the last requested batch
+        QTRY_COMPARE(h.steps.load(), 2u);
+        QTest::qWait(50);
+        query.execution().fetchMore();
+        QCOMPARE(query.matches().count(), 3u + 3u);
+    }
+}
+
+void AlbertTests::query_engine_speculation()
+{
+    app().settings()->remove(u"speculativeExecution"_s);
+    app().settings()->setValue(u"speculationTimeout"_s, 100);
+
+    ExtensionRegistry registry;
+    MockGlobalHandler handler(u"h"_s, {RankItem(make_shared<MockDynamicItem>(u"a"_s), .5)});
+    QueryEngine engine(registry);
+    registry.registerExtension(&handler);
+
+    // Disabled by default
+    QVERIFY(!engine.speculativeExecution());
+    engine.speculate(u"x"_s);
+    QVERIFY(!engine.adoptSpeculation(u"x"_s));
+
+    // The last input and the empty query are speculated, adopting transfers ownership
+    engine.setSpeculativeExecution(true);
+    engine.speculate(u"x"_s);
+    auto query = engine.adoptSpeculation(u"x"_s);
+    QVERIFY(query);
+    QCOMPARE(query->query(), u"x"_s);
+    QVERIFY(!engine.adoptSpeculation(u"x"_s));
+    QVERIFY(engine.adoptSpeculation(QString()));
+    awaitInactive(*query);
+    QCOMPARE(query->matches().count(), 1u);
+
+    // Discarded speculations are not adoptable
+    engine.speculate(u"x"_s);
+    engine.discardSpeculations();
+    QVERIFY(!engine.adoptSpeculation(u"x"_s));
+
+    // Speculations expire
+    engine.speculate(u"x"_s);
+    QTest::qWait(200);
+    QVERIFY(!engine.adoptSpeculation(u"x"_s));
+
+    engine.setSpeculativeExecution(false);
+    registry.deregisterExtension(&handler);
+    app().settings()->remove(u"speculationTimeout"_s);
+}
+
+void AlbertTests::global_query_rank_empty_query()
+{
+    BlockingEmptyQueryHandler h;
+    h.released = true;
+
+    CancellationToken token;
+    auto results = GlobalQuery::rankEmptyQuery({&h}, nullUsageScoring(), token);
+    QCOMPARE(results.results.size(), 1u);
+    QCOMPARE(results.handler_generations.size(), 1u);
+
+    // Cancelled rebuilds skip the remaining handlers
+    token.cancel();
+    results = GlobalQuery::rankEmptyQuery({&h}, nullUsageScoring(), token);
+    QVERIFY(results.results.empty());
+    QCOMPARE(h.calls.load(), 1u);
+}
+
+void AlbertTests::query_engine_empty_query_handler_removal()
+{
+    ExtensionRegistry registry;
+    BlockingEmptyQueryHandler handler;
+    QueryEngine engine(registry);
+    registry.registerExtension(&handler);
+
+    // Precomputed although the handler has no result generation
+    QTRY_COMPARE(handler.calls.load(), 1u);
+
+    // The removal awaits the rebuild calling the handler without blocking the event loop
+    bool events_processed = false;
+    QTimer::singleShot(10, [&]{ events_processed = true; });
+    QTimer::singleShot(50, [&]{ handler.released = true; });
+    registry.deregisterExtension(&handler);
+    QVERIFY(events_processed);
+    QVERIFY(handler.released);
+
+    // The results of the cancelled rebuild are dropped before the handler is gone
+    QVERIFY(handler.produced.expired());
+}
+
+void AlbertTests::session_history()
+{
+    ExtensionRegistry registry;
+    BlockingGlobalHandler handler;
+    QueryEngine engine(registry);
+    engine.setSpeculativeExecution(false);
+    registry.registerExtension(&handler);
+    MockFrontend frontend;
+
+    {
+        Session session(engine, frontend);  // Empty query, does not block
+        QVERIFY(frontend.query);
+
+        frontend.setInput(u"a"_s);
+        frontend.setInput(u"ab"_s);
+        QCOMPARE(frontend.query->query(), u"ab"_s);
+
+        // The previous query is kept for display, the empty one retired and deleted
+        QTRY_COMPARE(frontend.deleted_queries, 1);
+
+        // Retired, but still active in the handler
+        frontend.setInput(u"abc"_s);
+        QCoreApplication::processEvents();
+        QCOMPARE(frontend.deleted_queries, 1);
+
+        // Deleted once inactive
+        handler.released = true;
+        QTRY_COMPARE(frontend.deleted_queries, 2);
+    }
+
+    QTRY_COMPARE(frontend.deleted_queries, 4);
+    registry.deregisterExtension(&handler);
+}
+
+void AlbertTests::global_query_cancel_releases_results()
+{
+    vector<RankItem> items;
+    for (int i = 0; i < 100; ++i)
+        items.emplace_back(make_shared<MockDynamicItem>(QString::number(i)), .5);
+    MockGlobalHandler h(u"h"_s, ::move(items));
+    GlobalQuery global_query;
+    global_query.handlers = {{h.id(), &h}};
+
+    detail::Query query(nullUsageScoring(), {}, global_query, {}, u"x"_s);
+    awaitInactive(query);
+    QVERIFY(query.matches().count() > 0);
+    QVERIFY(query.execution().canFetchMore());
+
+    query.cancel();
+    QVERIFY(!query.execution().canFetchMore());
+    QVERIFY(!query.isValid());
+}
+
+void AlbertTests::mpsc_queue_full()
+{
+    MpscQueue<int, 8> queue;
+    QVERIFY(queue.empty());
+
+    uint dropped = 0;
+    for (int i = 0; i < 11; ++i)
+        if (!queue.push(int(i)))
+            ++dropped;
+    QCOMPARE(dropped, 3u);
+    QVERIFY(!queue.empty());
+
+    // FIFO, the entries pushed when full are dropped
+    int value;
+    for (int i = 0; i < 8; ++i)
+    {
+        QVERIFY(queue.pop(value));
+        QCOMPARE(value, i);
+    }
+    QVERIFY(!queue.pop(value));
+    QVERIFY(queue.empty());
+
+    // Slots are reused
+    QVERIFY(queue.push(42));
+    QVERIFY(queue.pop(value));
+    QCOMPARE(value, 42);
+}
+
+void AlbertTests::mpsc_queue_concurrent_producers()
+{
+    static const int producer_count = 4;
+    static const int pushes = 100000;
+    MpscQueue<pair<int, int>, 64> queue;  // Small, producers contend and drop
+
+    atomic_int dropped = 0;
+    vector<thread> producers;
+    for (int p = 0; p < producer_count; ++p)
+        producers.emplace_back([&, p] {
+            for (int i = 0; i < pushes; ++i)
+                if (!queue.push({p, i}))
+                    ++dropped;
+        });
+
+    // Per producer order is retained, every entry is received once
+    array<int, producer_count> last;
+    last.fill(-1);
+    int received = 0;
+    bool ordered = true;
+    pair<int, int> value;
+    const auto consume = [&] {
+        while (queue.pop(value))
+        {
+            ordered &= value.second > last[value.first];
+            last[value.first] = value.second;
+            ++received;
+        }
+    };
+
+    while (received + dropped < producer_count * pushes)
+        consume();
+
+    for (auto &producer : producers)
+        producer.join();
+    consume();
+
+    QVERIFY(ordered);
+    QCOMPARE(received + dropped, producer_count * pushes);
+    QVERIFY(queue.empty());
+}
+
 void AlbertTests::input_history()
 {
     // Create a temporary file
@@ -821,6 +1815,552 @@ void AlbertTests::input_history()
 //     return tmp_s;
 // }
 
+static detail::DesktopEntryParser parseDesktopEntry(const QByteArray &contents)
+{
+    QTemporaryFile t;
+    if (!t.open() || t.write(contents) != contents.size())
+        throw runtime_error("Failed writing temporary desktop entry.");
+    t.close();
+    return detail::DesktopEntryParser(t.fileName());
+}
+
+void AlbertTests::desktop_entry_parser_groups()
+{
+    QTemporaryFile t;
+    QVERIFY(t.open());
+    t.write("# Comment\n"
+            "[Desktop Entry]\n"
+            "Name = App\n"
+            "Exec=app\n"
+            "Name=Shadowed\n"
+            "\n"
+            "[Desktop Action new]\n"
+            "Name=New Window\n"
+            "Terminal=true\n");
+    t.close();
+
+    auto parser = make_unique<detail::DesktopEntryParser>(t.fileName());
+    auto p = *parser;  // Copies share the buffer
+    parser.reset();
+
+    QCOMPARE(p.getString(u"Desktop Entry"_s, u"Name"_s), u"App"_s);  // First key wins
+    QCOMPARE(p.getString(u"Desktop Entry"_s, u"Exec"_s), u"app"_s);
+    QCOMPARE(p.getString(u"Desktop Action new"_s, u"Name"_s), u"New Window"_s);
+    QVERIFY(p.getBoolean(u"Desktop Action new"_s, u"Terminal"_s));
+    QVERIFY_THROWS_EXCEPTION(out_of_range, p.getString(u"Desktop Entry"_s, u"Icon"_s));
+    QVERIFY_THROWS_EXCEPTION(out_of_range, p.getString(u"Missing"_s, u"Name"_s));
+    QVERIFY_THROWS_EXCEPTION(runtime_error, detail::DesktopEntryParser(u"/nonexistent"_s));
+}
+
+void AlbertTests::desktop_entry_parser_localized_keys()
+{
+    const auto previous_locale = QLocale();
+    QLocale::setDefault(QLocale(u"de_DE"_s));
+    auto p = parseDesktopEntry("[Desktop Entry]\n"
+                               "Name=Files\n"
+                               "Name[de]=Dateien\n"
+                               "Name[fr]=Fichiers\n"
+                               "Comment=Browse\n"
+                               "Comment[de_DE]=Durchsuchen\n"
+                               "Keywords=folder\n"
+                               "GenericName[de]=Datei\\sManager\n"_ba);
+    QLocale::setDefault(previous_locale);
+
+    QCOMPARE(p.getLocaleString(u"Desktop Entry"_s, u"Name"_s), u"Dateien"_s);
+    QCOMPARE(p.getLocaleString(u"Desktop Entry"_s, u"Comment"_s), u"Durchsuchen"_s);
+    QCOMPARE(p.getLocaleString(u"Desktop Entry"_s, u"Keywords"_s), u"folder"_s);
+    QCOMPARE(p.getLocaleString(u"Desktop Entry"_s, u"GenericName"_s), u"Datei Manager"_s);
+    QVERIFY_THROWS_EXCEPTION(out_of_range,  // Other locales are skipped
+                             p.getString(u"Desktop Entry"_s, u"Name[fr]"_s));
+}
+
+void AlbertTests::desktop_entry_parser_escapes()
+{
+    auto p = parseDesktopEntry(R"([Desktop Entry]
+Comment=a\sb\nc\td\re\\f
+Icon=/path/with\sspace.png
+Exec="/opt/my app/bin" --arg "a \\"quoted\\" \\\\ word"
+)"_ba);
+
+    QCOMPARE(p.getString(u"Desktop Entry"_s, u"Comment"_s), u"a b\nc\td\re\\f"_s);
+    QCOMPARE(p.getIconString(u"Desktop Entry"_s, u"Icon"_s), u"/path/with space.png"_s);
+
+    const auto exec = detail::DesktopEntryParser::splitExec(
+        p.getString(u"Desktop Entry"_s, u"Exec"_s));
+    QVERIFY(exec);
+    QCOMPARE(*exec, QStringList({u"/opt/my app/bin"_s, u"--arg"_s, uR"(a "quoted" \ word)"_s}));
+    QVERIFY(!detail::DesktopEntryParser::splitExec(u"\"unterminated"_s));
+}
+
+void AlbertTests::desktop_entry_parser_gettext_domain()
+{
+    // Without a catalog dgettext returns the message id. The domain is unescaped.
+    auto p = parseDesktopEntry("[Desktop Entry]\n"
+                               "Name=Files\n"
+                               "X-Ubuntu-Gettext-Domain=albert\\stest\n"_ba);
+    QCOMPARE(p.getLocaleString(u"Desktop Entry"_s, u"Name"_s), u"Files"_s);
+    QCOMPARE(p.getString(u"Desktop Entry"_s, u"X-Ubuntu-Gettext-Domain"_s), u"albert test"_s);
+}
+
+// Application dirs of higher and lower precedence, restores the environment when destroyed
+struct TestApplicationDirs
+{
+    TestApplicationDirs()
+        : xdg_data_home(qgetenv("XDG_DATA_HOME"))
+        , xdg_data_dirs(qgetenv("XDG_DATA_DIRS"))
+    {
+        qputenv("XDG_DATA_HOME", home.path().toLocal8Bit());
+        qputenv("XDG_DATA_DIRS", system.path().toLocal8Bit());
+        QFile::remove(cacheFilePath());
+    }
+
+    ~TestApplicationDirs()
+    {
+        detail::DesktopEntryScanner::shutdown();
+        QFile::remove(cacheFilePath());
+        qputenv("XDG_DATA_HOME", xdg_data_home);
+        qputenv("XDG_DATA_DIRS", xdg_data_dirs);
+    }
+
+    static QString cacheFilePath()
+    { return QDir(albert::app().cacheLocation()).filePath(u"desktop-entries.cache"_s); }
+
+    static void write(const QTemporaryDir &dir, const QString &relative_path, const QString &name)
+    {
+        const auto path = u"%1/applications/%2"_s.arg(dir.path(), relative_path);
+        QDir().mkpath(QFileInfo(path).path());
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(u"[Desktop Entry]\nType=Application\nName=%1\n"_s.arg(name).toUtf8());
+    }
+
+    QTemporaryDir home;
+    QTemporaryDir system;
+    const QByteArray xdg_data_home;
+    const QByteArray xdg_data_dirs;
+};
+
+static QStringList ids(const vector<detail::DesktopEntryScanner::Entry> &entries)
+{
+    QStringList ids;
+    for (const auto &entry : entries)
+        ids << entry.id;
+    ids.sort();
+    return ids;
+}
+
+static QString name(const detail::DesktopEntryScanner::Entry &entry)
+{ return entry.parser->getString(u"Desktop Entry"_s, u"Name"_s); }
+
+void AlbertTests::desktop_entry_scanner_changes()
+{
+    using ChangeSet = detail::DesktopEntryScanner::ChangeSet;
+
+    TestApplicationDirs dirs;
+    dirs.write(dirs.home, u"a.desktop"_s, u"A home"_s);
+    dirs.write(dirs.system, u"a.desktop"_s, u"A system"_s);
+    dirs.write(dirs.system, u"b.desktop"_s, u"B"_s);
+    dirs.write(dirs.system, u"sub/c.desktop"_s, u"C"_s);
+
+    vector<ChangeSet> changes;
+    auto &scanner = detail::DesktopEntryScanner::instance();
+    QObject::connect(&scanner, &detail::DesktopEntryScanner::changed,
+                     &scanner, [&](const ChangeSet &c) { changes.push_back(c); });
+
+    QTRY_COMPARE(changes.size(), 1u);
+    QCOMPARE(ids(changes[0].added),
+             (QStringList{u"a.desktop"_s, u"b.desktop"_s, u"sub-c.desktop"_s}));
+    QVERIFY(changes[0].modified.empty());
+    QVERIFY(changes[0].removed.empty());
+
+    // Ids in directories of higher precedence shadow the others
+    const auto &entries = scanner.entries();
+    QCOMPARE(entries.size(), 3u);
+    QCOMPARE(name(entries.at(u"a.desktop"_s)), u"A home"_s);
+    QCOMPARE(entries.at(u"sub-c.desktop"_s).path,
+             u"%1/applications/sub/c.desktop"_s.arg(dirs.system.path()));
+
+    // Diff
+    changes.clear();
+    dirs.write(dirs.system, u"b.desktop"_s, u"B modified"_s);
+    dirs.write(dirs.system, u"d.desktop"_s, u"D"_s);
+    QVERIFY(QFile::remove(u"%1/applications/sub/c.desktop"_s.arg(dirs.system.path())));
+    scanner.rescan();
+
+    QTRY_VERIFY(!changes.empty());
+    QCOMPARE(ids(changes[0].added), QStringList{u"d.desktop"_s});
+    QCOMPARE(ids(changes[0].modified), QStringList{u"b.desktop"_s});
+    QCOMPARE(changes[0].removed, vector<QString>{u"sub-c.desktop"_s});
+    QCOMPARE(name(scanner.entries().at(u"b.desktop"_s)), u"B modified"_s);
+
+    // Removing the shadowing entry modifies the id
+    changes.clear();
+    QVERIFY(QFile::remove(u"%1/applications/a.desktop"_s.arg(dirs.home.path())));
+    scanner.rescan();
+
+    QTRY_VERIFY(!changes.empty());
+    QVERIFY(changes[0].added.empty());
+    QCOMPARE(ids(changes[0].modified), QStringList{u"a.desktop"_s});
+    QCOMPARE(name(scanner.entries().at(u"a.desktop"_s)), u"A system"_s);
+}
+
+void AlbertTests::desktop_entry_scanner_cache()
+{
+    TestApplicationDirs dirs;
+    dirs.write(dirs.system, u"a.desktop"_s, u"A"_s);
+    dirs.write(dirs.system, u"b.desktop"_s, u"B"_s);
+
+    {
+        auto &scanner = detail::DesktopEntryScanner::instance();
+        QTRY_COMPARE(scanner.entries().size(), 2u);
+        detail::DesktopEntryScanner::shutdown();  // Waits for the scan writing the cache
+    }
+    QVERIFY(QFile::exists(dirs.cacheFilePath()));
+
+    // Round trip, the entries are available before the first scan finished
+    {
+        auto &scanner = detail::DesktopEntryScanner::instance();
+        const auto &entries = scanner.entries();
+        QCOMPARE(entries.size(), 2u);
+        QCOMPARE(name(entries.at(u"a.desktop"_s)), u"A"_s);
+        QCOMPARE(entries.at(u"b.desktop"_s).path,
+                 u"%1/applications/b.desktop"_s.arg(dirs.system.path()));
+
+        // Unchanged files are not reported as modified
+        bool changed = false;
+        QObject::connect(&scanner, &detail::DesktopEntryScanner::changed,
+                         &scanner, [&] { changed = true; });
+        QTest::qWait(500);
+        QVERIFY(!changed);
+        detail::DesktopEntryScanner::shutdown();
+    }
+
+    // Localizations of other locales are not cached
+    const auto locale = QLocale();
+    QLocale::setDefault(locale.language() == QLocale::German ? QLocale(QLocale::French)
+                                                             : QLocale(QLocale::German));
+    QVERIFY(detail::DesktopEntryScanner::instance().entries().empty());
+    detail::DesktopEntryScanner::shutdown();
+    QLocale::setDefault(locale);
+}
+
+void AlbertTests::image_icon_blocking_decode()
+{
+    QTemporaryFile file(QDir::tempPath() + u"/albert_test_XXXXXX.png"_s);
+    QVERIFY(file.open());
+    QImage red(16, 16, QImage::Format_ARGB32_Premultiplied);
+    red.fill(Qt::red);
+    QVERIFY(red.save(&file, "PNG"));
+    file.close();
+
+    ImageIcon icon(file.fileName());
+    QVERIFY(!icon.cacheKey().isEmpty());  // Pixmaps never contain placeholders
+
+    // Consumers without repaint notification get the decoded image on first paint
+    QImage target(16, 16, QImage::Format_ARGB32_Premultiplied);
+    target.fill(Qt::transparent);
+    {
+        IconLoader::BlockingScope blocking;
+        QPainter p(&target);
+        icon.paint(&p, target.rect());
+    }
+    QCOMPARE(target.pixelColor(8, 8), QColor(Qt::red));
+}
+
+static QJsonArray traceEvents()
+{ return QJsonDocument::fromJson(Trace::toChromeTrace()).object()[u"traceEvents"_s].toArray(); }
+
+void AlbertTests::trace_ring_wrap_around()
+{
+    const auto overwritten = 10;
+    for (size_t i = 0; i < Trace::capacity + overwritten; ++i)
+        Trace::record("test", "wrap", QString::number(i), Trace::Clock::now());
+
+    set<int> recorded;
+    qsizetype ring_events = 0;
+    for (const auto &v : traceEvents())
+    {
+        const auto o = v.toObject();
+        if (const auto cat = o[u"cat"_s].toString(); cat != u"app"_s && cat != u"plugin"_s)
+            ++ring_events;
+        if (o[u"name"_s].toString() == u"wrap"_s)
+            recorded.insert(o[u"args"_s].toObject()[u"detail"_s].toString().toInt());
+    }
+
+    // The oldest spans are overwritten
+    QCOMPARE(ring_events, (qsizetype)Trace::capacity);
+    QCOMPARE(recorded.size(), Trace::capacity);
+    QCOMPARE(*recorded.begin(), overwritten);
+    QCOMPARE(*recorded.rbegin(), (int)Trace::capacity + overwritten - 1);
+}
+
+void AlbertTests::trace_startup_bound()
+{
+    for (size_t i = 0; i < Trace::startup_capacity + 10; ++i)
+        Trace::record("app", "startup", QString::number(i), Trace::Clock::now());
+
+    // Full, later spans are dropped. Frequent spans do not overwrite startup spans.
+    Trace::record("app", "late", {}, Trace::Clock::now());
+    for (size_t i = 0; i < Trace::capacity; ++i)
+        Trace::record("test", "frequent", {}, Trace::Clock::now());
+
+    qsizetype startup_events = 0;
+    bool first_kept = false;
+    for (const auto &v : traceEvents())
+    {
+        const auto o = v.toObject();
+        if (const auto cat = o[u"cat"_s].toString(); cat == u"app"_s || cat == u"plugin"_s)
+            ++startup_events;
+        QVERIFY(o[u"name"_s].toString() != u"late"_s);
+        if (o[u"name"_s].toString() == u"startup"_s
+            && o[u"args"_s].toObject()[u"detail"_s].toString() == u"0"_s)
+            first_kept = true;
+    }
+    QCOMPARE(startup_events, (qsizetype)Trace::startup_capacity);
+    QVERIFY(first_kept);
+}
+
+void AlbertTests::trace_chrome_json()
+{
+    const auto begin = Trace::Clock::now();
+    Trace::record("test", "json", u"detail"_s, begin, begin + 1500us);
+    {
+        Trace::Span span("test", "span");
+    }
+
+    const auto doc = QJsonDocument::fromJson(Trace::toChromeTrace());
+    QVERIFY(doc.isObject());
+    QCOMPARE(doc.object()[u"displayTimeUnit"_s].toString(), u"ms"_s);
+
+    const auto events = doc.object()[u"traceEvents"_s].toArray();
+    QVERIFY(!events.isEmpty());
+
+    QJsonObject json, span;
+    for (const auto &v : events)
+    {
+        const auto o = v.toObject();
+        if (o[u"name"_s].toString() == u"json"_s)
+            json = o;
+        else if (o[u"name"_s].toString() == u"span"_s)
+            span = o;
+    }
+
+    // Complete events
+    QCOMPARE(json[u"cat"_s].toString(), u"test"_s);
+    QCOMPARE(json[u"ph"_s].toString(), u"X"_s);
+    QVERIFY(json[u"ts"_s].isDouble());
+    QCOMPARE(json[u"dur"_s].toInteger(), 1500);
+    QCOMPARE(json[u"pid"_s].toInteger(), QCoreApplication::applicationPid());
+    QVERIFY(json[u"tid"_s].isDouble());
+    QCOMPARE(json[u"args"_s].toObject()[u"detail"_s].toString(), u"detail"_s);
+
+    QCOMPARE(span[u"ph"_s].toString(), u"X"_s);
+    QVERIFY(!span.contains(u"args"_s));  // No detail
+    QVERIFY(span[u"ts"_s].toInteger() >= json[u"ts"_s].toInteger());
+}
+
+// Theme with a name unique to the temporary dir, such that stale caches do not interfere
+struct TestTheme
+{
+    TestTheme()
+    {
+        name = u"albert-test-%1"_s.arg(QFileInfo(dir.path()).fileName());
+        QDir(dir.path()).mkpath(name);
+        write(u"index.theme"_s,
+              "[Icon Theme]\n"
+              "Name=Test\n"
+              "Inherits=hicolor\n"
+              "Directories=16x16/apps,48x48/apps,scalable/apps\n"
+              "\n"
+              "[16x16/apps]\nSize=16\nType=Fixed\n"
+              "\n"
+              "[48x48/apps]\nSize=48\nType=Fixed\n"
+              "\n"
+              "[scalable/apps]\nSize=64\nMinSize=8\nMaxSize=512\nType=Scalable\n"_ba);
+        for (const auto &file : {u"16x16/apps/foo.png"_s,
+                                 u"48x48/apps/foo.svg"_s,
+                                 u"48x48/apps/foo.png"_s,
+                                 u"scalable/apps/foo.svg"_s,
+                                 u"scalable/apps/bar.svg"_s})
+            write(file);
+    }
+
+    ~TestTheme() { QFile::remove(cacheFilePath()); }
+
+    void write(const QString &relative_path, const QByteArray &content = {})
+    {
+        const auto path = u"%1/%2/%3"_s.arg(dir.path(), name, relative_path);
+        QDir().mkpath(QFileInfo(path).path());
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(content);
+    }
+
+    QString cacheFilePath() const
+    { return QDir(albert::app().cacheLocation()).filePath(u"icon-themes/%1.index"_s.arg(name)); }
+
+    QString relativePath(const XDG::ThemeIndex &index, const QString &icon, int size) const
+    {
+        const auto *entry = index.bestEntry(icon, size);
+        return entry ? QDir(u"%1/%2"_s.arg(dir.path(), name)).relativeFilePath(index.path(icon, *entry))
+                     : QString{};
+    }
+
+    QTemporaryDir dir;
+    QString name;
+};
+
+void AlbertTests::theme_index_scan()
+{
+    TestTheme theme;
+    XDG::ThemeIndex index(theme.name, {theme.dir.path()});
+
+    QVERIFY(index.isValid());
+    QCOMPARE(index.inherits(), QStringList{u"hicolor"_s});
+
+    // Largest directories first
+    QCOMPARE(index.directories().size(), 3);
+    QCOMPARE(index.directories()[0].path, u"scalable/apps"_s);
+    QCOMPARE(index.directories()[1].path, u"48x48/apps"_s);
+    QCOMPARE(index.directories()[2].path, u"16x16/apps"_s);
+
+    QCOMPARE(index.entries(u"foo"_s)->size(), 4);
+    QCOMPARE(index.entries(u"bar"_s)->size(), 1);
+    QVERIFY(!index.entries(u"baz"_s));
+
+    QCOMPARE(theme.relativePath(index, u"foo"_s, 0), u"scalable/apps/foo.svg"_s);
+    QCOMPARE(theme.relativePath(index, u"foo"_s, 16), u"16x16/apps/foo.png"_s);
+    QCOMPARE(theme.relativePath(index, u"foo"_s, 48), u"48x48/apps/foo.png"_s);  // png preferred
+    QCOMPARE(theme.relativePath(index, u"foo"_s, 256), u"scalable/apps/foo.svg"_s);
+    QCOMPARE(theme.relativePath(index, u"bar"_s, 16), u"scalable/apps/bar.svg"_s);
+
+    QVERIFY(!XDG::ThemeIndex(u"albert-nonexistent"_s, {theme.dir.path()}).isValid());
+}
+
+void AlbertTests::theme_index_cache()
+{
+    TestTheme theme;
+    {
+        XDG::ThemeIndex index(theme.name, {theme.dir.path()});
+        QVERIFY(index.isValid());
+    }
+    QVERIFY(QFile::exists(theme.cacheFilePath()));
+
+    // Round trip
+    {
+        XDG::ThemeIndex index(theme.name, {theme.dir.path()});
+        QVERIFY(index.isValid());
+        QCOMPARE(index.inherits(), QStringList{u"hicolor"_s});
+        QCOMPARE(index.directories().size(), 3);
+        QCOMPARE(index.entries(u"foo"_s)->size(), 4);
+        QCOMPARE(theme.relativePath(index, u"foo"_s, 16), u"16x16/apps/foo.png"_s);
+        QVERIFY(!index.entries(u"baz"_s));
+    }
+
+    // Adding a file changes the modification time of its directory
+    QTest::qSleep(10);
+    theme.write(u"16x16/apps/baz.png"_s);
+    {
+        XDG::ThemeIndex index(theme.name, {theme.dir.path()});
+        QVERIFY(index.entries(u"baz"_s));
+        QCOMPARE(theme.relativePath(index, u"baz"_s, 16), u"16x16/apps/baz.png"_s);
+    }
+
+    // Different icon dirs
+    {
+        QTemporaryDir other;
+        XDG::ThemeIndex index(theme.name, {other.path(), theme.dir.path()});
+        QCOMPARE(index.entries(u"foo"_s)->size(), 4);
+        QCOMPARE(index.path(u"foo"_s, *index.bestEntry(u"foo"_s, 16)),
+                 u"%1/%2/16x16/apps/foo.png"_s.arg(theme.dir.path(), theme.name));
+    }
+}
+
+void AlbertTests::theme_index_corrupt_cache()
+{
+    TestTheme theme;
+    const QStringList icon_dirs{theme.dir.path()};
+    const auto index_file = u"%1/%2/index.theme"_s.arg(theme.dir.path(), theme.name);
+
+    const auto write_cache = [&](const auto &write_body) {
+        QFile file(theme.cacheFilePath());
+        QDir().mkpath(QFileInfo(file).path());
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QDataStream s(&file);
+        s << (quint32)0x616c6274 << (quint32)1 << theme.name << icon_dirs << index_file
+          << QStringList{};
+        write_body(s);
+    };
+
+    const auto verify_rescanned = [&] {
+        XDG::ThemeIndex index(theme.name, icon_dirs);
+        QVERIFY(index.isValid());
+        QCOMPARE(index.directories().size(), 3);
+        QCOMPARE(index.entries(u"foo"_s)->size(), 4);
+    };
+
+    // Huge directory count
+    write_cache([](QDataStream &s) { s << (quint32)0xffffffff; });
+    verify_rescanned();
+
+    // Huge icon count
+    write_cache([](QDataStream &s) { s << (quint32)0 << (quint32)0xffffffff; });
+    verify_rescanned();
+
+    // Huge entry count
+    write_cache([](QDataStream &s) {
+        s << (quint32)0 << (quint32)1 << u"foo"_s << (quint32)0xffffffff;
+    });
+    verify_rescanned();
+
+    // Well-formed but directory index out of range
+    write_cache([](QDataStream &s) {
+        s << (quint32)1 << u"16x16/apps"_s << 16 << 16 << 16 << 2 << (qint8)0
+          << (quint32)1 << u"foo"_s << (quint32)1 << (quint16)7 << (quint8)0 << (quint8)0;
+    });
+    verify_rescanned();
+
+    // Truncated
+    write_cache([](QDataStream &s) { s << (quint32)3; });
+    verify_rescanned();
+}
+
+void AlbertTests::icon_lookup_size_buckets()
+{
+    TestTheme theme;
+    XDG::IconLookup lookup({theme.dir.path()});
+    const auto path = [&](const QString &relative_path)
+    { return u"%1/%2/%3"_s.arg(theme.dir.path(), theme.name, relative_path); };
+
+    QCOMPARE(lookup.path(u"foo"_s, {40, 40}, theme.name), path(u"48x48/apps/foo.png"_s));
+    QCOMPARE(lookup.path(u"foo.png"_s, {16, 16}, theme.name), path(u"16x16/apps/foo.png"_s));
+    QCOMPARE(lookup.path(u"foo"_s, {}, theme.name), path(u"scalable/apps/foo.svg"_s));
+
+    // Changes in icon directories are not watched. Sizes of the same bucket hit the cache.
+    QVERIFY(QFile::remove(path(u"48x48/apps/foo.png"_s)));
+    QCOMPARE(lookup.path(u"foo"_s, {33, 33}, theme.name), path(u"48x48/apps/foo.png"_s));
+
+    // Other buckets do not
+    QCOMPARE(lookup.path(u"foo"_s, {64, 64}, theme.name), path(u"scalable/apps/foo.svg"_s));
+}
+
+void AlbertTests::icon_lookup_negative_entries()
+{
+    TestTheme theme;
+    XDG::IconLookup lookup({theme.dir.path()});
+
+    QVERIFY(lookup.path(u"baz"_s, {16, 16}, theme.name).isNull());
+
+    // Installations update the icon cache in the theme root
+    QTest::qSleep(10);  // Directory modification time resolution
+    theme.write(u"16x16/apps/baz.png"_s);
+    QVERIFY(lookup.path(u"baz"_s, {16, 16}, theme.name).isNull());  // Cached miss
+    theme.write(u"icon-theme.cache"_s);
+
+    QTRY_COMPARE(lookup.path(u"baz"_s, {16, 16}, theme.name),
+                 u"%1/%2/16x16/apps/baz.png"_s.arg(theme.dir.path(), theme.name));
+}
+
 // static void levenshtein_compare_benchmarks_and_check_results(const vector<QString> &strings, uint k)
 // {
 //     Levenshtein l;
@@ -17,6 +17,7 @@ private slots:
     void topological_sort_not_existing_node();
 
     void plugin_registry();
+    void plugin_registry_deferral();
 
     void bench_tokenizer();
 
@@ -49,8 +50,60 @@ private slots:
     void index_score();
     void index_underscore();
 
+    void cancellation_token();
+    void metric_series_percentiles();
+    void metric_series_ring_overwrite();
+    void result_cache();
+    void index_query_handler_caching();
+
+    void query_results_coalesced_changes();
+    void query_results_rows_after_remove();
+    void query_results_deferred_changes();
+    void item_change_hub_removed_observers();
+
+    void global_query_rank_empty_query();
+    void query_engine_empty_query_handler_removal();
+    void query_engine_speculation();
+    void session_history();
+    void global_query_cancel_releases_results();
+
+    void global_query_deduplication_merge();
+    void global_query_deduplication_winner();
+    void global_query_deduplication_nested();
+
+    void global_query_schedule();
+    void global_query_budget_deadline();
+    void global_query_budget_drop_overruns();
+
+    void generator_query_on_demand();
+    void generator_query_read_ahead();
+    void generator_query_cancel_while_stepping();
+    void generator_query_batch_sizes();
+
+    void mpsc_queue_full();
+    void mpsc_queue_concurrent_producers();
+
     void input_history();
 
+    void desktop_entry_parser_groups();
+    void desktop_entry_parser_localized_keys();
+    void desktop_entry_parser_escapes();
+    void desktop_entry_parser_gettext_domain();
+    void desktop_entry_scanner_changes();
+    void desktop_entry_scanner_cache();
+
+    void image_icon_blocking_decode();
+
+    void trace_ring_wrap_around();
+    void trace_startup_bound();
+    void trace_chrome_json();
+
+    void theme_index_scan();
+    void theme_index_cache();
+    void theme_index_corrupt_cache();
+    void icon_lookup_size_buckets();
+    void icon_lookup_negative_entries();
+
     // void benchmark_comparison_vanilla_vs_fast_levenshtein();
 
     // void benchmark_hash_qstring();